@@ -51,6 +51,8 @@ int main() {
     kex::Texture texture("/tmp/tex.png");
     kex::Sprite sprite(texture);
     kex::Sprite sprite2(texture);
+    kex::SpriteBatch batch;
+    kex::SpriteBatch batch_nested;
 
     glClearColor(0.f, 0.f, 0.f, 1.f);
 
@@ -84,12 +86,12 @@ int main() {
         sprite2.scale_y = SDL_sinf(step * pi * 2);
 
         glClear(GL_COLOR_BUFFER_BIT);
-        {
-            kex::SpriteBatch batch;
-            kex::SpriteBatch batch_nested;
-            batch.add(sprite2);
-            batch_nested.add(sprite);
-        }
+        batch.begin();
+        batch_nested.begin();
+        batch.add(sprite2);
+        batch_nested.add(sprite);
+        batch_nested.flush();
+        batch.flush();
         SDL_GL_SwapWindow(window);
 
     }
@@ -0,0 +1,213 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_ATLAS_HPP
+#define KEX_ATLAS_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <kex/texture.hpp>
+#include <kex/sprite.hpp>
+#include <kex/def.hpp>
+
+namespace kex {
+
+    /**
+     * Named region of an atlas.
+     */
+    struct AtlasRegion {
+        /** Name under which the image was added to the atlas */
+        std::string name;
+
+        /** Region of the image within the atlas, without the padding */
+        RectangleDef rectangle;
+    };
+
+    /**
+     * Packed atlas image in memory.
+     */
+    struct AtlasImage {
+        /** Width of the atlas in pixels */
+        int width = 0;
+
+        /** Height of the atlas in pixels */
+        int height = 0;
+
+        /** RGBA pixels with 8 bits per channel, starting with the top row */
+        std::vector<unsigned char> pixels;
+
+        /** Regions of the packed images in the order in which they were added */
+        std::vector<AtlasRegion> regions;
+
+        /**
+         * Save the atlas into a binary atlas file.
+         *
+         * The file holds the pixels in the layout expected by OpenGL, so loading it requires no decoding. Regions
+         * are stored under the 64-bit FNV-1a hashes of their names.
+         *
+         * @param path Path to the atlas file
+         * @param mipmap Flag indicating whether to store a precomputed mipmap
+         * @throws std::runtime_error if the file cannot be written or if two names have the same hash
+         */
+        void save(const std::string &path, bool mipmap = false) const;
+    };
+
+    class TextureAtlas;
+
+    /**
+     * Packer of many small images into a single texture.
+     *
+     * Sprites from the same texture are drawn together, so packing images into an atlas lets a sprite batch draw
+     * them with a single draw call instead of one per image.
+     * @code{.cpp}
+     * kex::AtlasBuilder builder;
+     * builder.add("player", "player.png");
+     * builder.add("enemy", "enemy.png");
+     * const auto atlas = builder.build();
+     *
+     * kex::Sprite player = atlas.sprite("player");
+     * @endcode
+     */
+    class AtlasBuilder {
+    public:
+        /**
+         * Create an empty atlas builder.
+         *
+         * @param max_size Maximum width and height of the atlas in pixels
+         * @param padding Number of pixels around each image, filled by repeating the edges of the image
+         */
+        explicit AtlasBuilder(int max_size = 2048, int padding = 1);
+
+        /**
+         * Add an image file.
+         *
+         * @param name Name of the image within the atlas
+         * @param path Path to the image file
+         */
+        void add(const std::string &name, const std::string &path);
+
+        /**
+         * Add an encoded image from memory, e.g. a PNG file read by the application.
+         *
+         * @param name Name of the image within the atlas
+         * @param data Encoded image
+         * @param size Size of the encoded image in bytes
+         */
+        void add_encoded(const std::string &name, const unsigned char *data, std::size_t size);
+
+        /**
+         * Add decoded pixels.
+         *
+         * @param name Name of the image within the atlas
+         * @param pixels RGBA pixels with 8 bits per channel, starting with the top row of the image
+         * @param width Width of the image in pixels
+         * @param height Height of the image in pixels
+         */
+        void add_pixels(const std::string &name, const unsigned char *pixels, int width, int height);
+
+        /** Number of added images. */
+        [[nodiscard]] std::size_t size() const;
+
+        /**
+         * Pack the added images without uploading them.
+         *
+         * Images are packed with the skyline bottom-left heuristic into the smallest power-of-two atlas that fits
+         * them. This does not require an OpenGL context.
+         *
+         * @throws std::runtime_error if the images do not fit into the maximum atlas size
+         */
+        [[nodiscard]] AtlasImage compose() const;
+
+        /**
+         * Pack the added images and upload them into a single texture.
+         *
+         * @param mipmap Flag indicating whether to generate a texture mipmap
+         * @throws std::runtime_error if the images do not fit into the maximum atlas size
+         */
+        [[nodiscard]] TextureAtlas build(bool mipmap = false) const;
+
+        ~AtlasBuilder();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+    };
+
+    /**
+     * Texture with named regions, each holding one of the packed images.
+     *
+     * Atlases are either built at runtime by an AtlasBuilder or loaded from binary atlas files, e.g. ones written by
+     * the `kex-atlas` tool.
+     */
+    class TextureAtlas {
+    public:
+        /**
+         * Upload a packed atlas image.
+         *
+         * @param image Packed atlas image
+         * @param mipmap Flag indicating whether to generate a texture mipmap
+         */
+        explicit TextureAtlas(const AtlasImage &image, bool mipmap = false);
+
+        /**
+         * Load a binary atlas file, which is memory-mapped and uploaded without decoding.
+         *
+         * @param path Path to the atlas file
+         * @param mipmap Flag indicating whether to generate a texture mipmap if the file does not hold one
+         * @throws std::runtime_error if the file is not a valid atlas file
+         */
+        explicit TextureAtlas(const std::string &path, bool mipmap = false);
+
+        TextureAtlas(TextureAtlas &&atlas) noexcept;
+
+        TextureAtlas &operator=(TextureAtlas &&atlas) noexcept;
+
+        /** Texture holding all images of the atlas. */
+        [[nodiscard]] const Texture &texture() const;
+
+        /** Check whether the atlas holds an image with the specified name. */
+        [[nodiscard]] bool contains(const std::string &name) const;
+
+        /**
+         * Region of the image with the specified name.
+         *
+         * @throws std::out_of_range if there is no such image
+         */
+        [[nodiscard]] const RectangleDef &region(const std::string &name) const;
+
+        /**
+         * Create a sprite showing the image with the specified name.
+         *
+         * @throws std::out_of_range if there is no such image
+         */
+        [[nodiscard]] Sprite sprite(const std::string &name) const;
+
+        ~TextureAtlas();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+    };
+
+}
+
+#endif //KEX_ATLAS_HPP
@@ -25,6 +25,12 @@ namespace kex {
 
     enum BufferType {
         ARRAY,
+
+        /** Source of pixels uploaded into textures */
+        PIXEL_UNPACK,
+
+        /** Destination of pixels read from framebuffers */
+        PIXEL_PACK,
     };
 
     enum BufferUsage {
@@ -59,6 +65,12 @@ namespace kex {
 
         void orphan(int size = -1);
 
+        [[nodiscard]] int size() const;
+
+        [[nodiscard]] void *map(int size, int offset = 0, bool unsynchronized = false);
+
+        void unmap();
+
         ~Buffer();
 
     private:
@@ -73,6 +85,18 @@ namespace kex {
     using StaticArrayBuffer = ArrayBuffer<BufferUsage::STATIC>;
     using StreamArrayBuffer = ArrayBuffer<BufferUsage::STREAM>;
 
+    /**
+     * Buffer whose contents are uploaded into a texture when it is bound during `glTexImage*` or `glTexSubImage*`,
+     * which lets the driver transfer the pixels asynchronously.
+     */
+    using PixelUnpackBuffer = Buffer<BufferType::PIXEL_UNPACK, BufferUsage::STREAM>;
+
+    /**
+     * Buffer which receives pixels when it is bound during `glReadPixels`, which lets the driver transfer the pixels
+     * asynchronously. It is mapped for reading.
+     */
+    using PixelPackBuffer = Buffer<BufferType::PIXEL_PACK, BufferUsage::STREAM>;
+
 }
 
 #endif //KEX_BUFFER_HPP
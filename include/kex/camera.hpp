@@ -0,0 +1,84 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_CAMERA_HPP
+#define KEX_CAMERA_HPP
+
+#include <array>
+#include <kex/def.hpp>
+
+namespace kex {
+
+    /**
+     * View onto the world of sprites.
+     *
+     * Sprite batches apply the camera on the GPU, so panning, zooming or rotating the view does not require updating
+     * any sprite:
+     * @code{.cpp}
+     * kex::Camera camera;
+     * camera.x += scroll_speed;
+     * batch.set_camera(camera);
+     * @endcode
+     *
+     * The default camera shows the world exactly as without a camera.
+     */
+    class Camera {
+    public:
+        /** @name Translation
+         */
+        ///@{
+        /** Horizontal offset of the view in the world. */
+        float x = 0.f;
+
+        /** Vertical offset of the view in the world. */
+        float y = 0.f;
+
+        /**
+         * Set the offset of the view in the world.
+         *
+         * @param x Horizontal offset of the view
+         * @param y Vertical offset of the view
+         */
+        void set_position(float x, float y);
+        ///@}
+
+        /** Magnification around the center of the view, values above 1 zoom in. */
+        float zoom = 1.f;
+
+        /** Counterclockwise (CCW) rotation of the camera around the center of the view in radians. */
+        float rotation = 0.f;
+
+        /**
+         * Retrieve a 3 x 2 column-major matrix transforming world coordinates into the logical viewport.
+         * @return Matrix representing the view
+         */
+        [[nodiscard]] std::array<float, 3 * 2> view() const;
+
+        /**
+         * Compute the axis-aligned bounding box of the part of the world visible in the logical viewport.
+         *
+         * Useful for querying a SpriteGrid.
+         *
+         * @return Visible part of the world, rounded outwards to whole pixels
+         */
+        [[nodiscard]] RectangleDef visible_area() const;
+    };
+
+}
+
+#endif //KEX_CAMERA_HPP
@@ -38,6 +38,26 @@ namespace kex {
         int h;
     };
 
+    /**
+     * Where the transformation matrices of sprites are computed.
+     */
+    enum SpriteTransform {
+        /**
+         * Matrices are computed on the CPU and uploaded per sprite.
+         *
+         * Batches and recorders cache the matrices of the sprites they record in the order the sprites are added,
+         * so a sprite added at the same position as in the previous frame skips the trigonometry unless its size,
+         * rotation, scale or shear changed.
+         */
+        CPU,
+
+        /**
+         * Position, size, rotation and shear are uploaded per sprite and the vertex shader composes the matrix,
+         * which moves the trigonometry to the GPU. Shear factors are uploaded with half precision.
+         */
+        GPU,
+    };
+
 }
 
 #endif //KEX_DEF_HPP
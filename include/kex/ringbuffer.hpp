@@ -0,0 +1,83 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_RINGBUFFER_HPP
+#define KEX_RINGBUFFER_HPP
+
+#include <memory>
+#include <kex/buffer.hpp>
+
+namespace kex {
+
+    /**
+     * Streaming buffer split into regions that are written in a round-robin fashion.
+     *
+     * Ranges of the current region are mapped without synchronization. Once a region is exhausted, a fence is
+     * inserted after the commands that read from it and writing continues in the next region, waiting only if the
+     * GPU has not finished reading from that region yet. Upload cost therefore does not depend on how a driver
+     * handles buffer orphaning.
+     *
+     * A region grows (and the whole buffer is reallocated) when a single mapping does not fit into it.
+     */
+    template<BufferType T>
+    class RingBuffer {
+    public:
+        /**
+         * Create a ring buffer.
+         *
+         * @param region_size Initial size of each region in bytes
+         * @param regions Number of regions, i.e. the number of uploads that can be in flight
+         */
+        explicit RingBuffer(int region_size, int regions = 3);
+
+        RingBuffer(RingBuffer &&ring_buffer) noexcept;
+
+        /** Underlying buffer. */
+        [[nodiscard]] const Buffer<T, BufferUsage::STREAM> &buffer() const;
+
+        /**
+         * Map a range of the ring buffer for writing.
+         *
+         * The returned range is valid until unmap() is called.
+         *
+         * @param size Size of the range in bytes
+         * @param offset Offset of the range within the underlying buffer
+         * @return Pointer to the mapped range
+         */
+        [[nodiscard]] void *map(int size, int &offset);
+
+        /**
+         * Unmap the previously mapped range.
+         */
+        void unmap();
+
+        ~RingBuffer();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+    };
+
+    using ArrayRingBuffer = RingBuffer<BufferType::ARRAY>;
+
+    using PixelUnpackRingBuffer = RingBuffer<BufferType::PIXEL_UNPACK>;
+
+}
+
+#endif //KEX_RINGBUFFER_HPP
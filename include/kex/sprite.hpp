@@ -19,22 +19,29 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef KEX_SPRITE_HPP
 #define KEX_SPRITE_HPP
 
-#include <memory>
+#include <array>
+#include <cstdint>
 #include <kex/texture.hpp>
 #include <kex/def.hpp>
 
 namespace kex {
 
+    /**
+     * Textured rectangle with a position, rotation, scale, shear and tint.
+     *
+     * Sprites are small, trivially copyable values which refer to their texture and its region by handles, so they
+     * can be stored in contiguous containers and copied freely. The texture must outlive its sprites.
+     */
     class Sprite {
     public:
         /** @name Translation
          */
         ///@{
         /** x-coordinate of the center of the sprite. */
-        float x;
+        float x = 0.f;
 
         /** y-coordinate of the center of the sprite. */
-        float y;
+        float y = 0.f;
 
         /**
          * Set the position of the sprite.
@@ -164,7 +171,22 @@ namespace kex {
          */
         explicit Sprite(const Texture &texture, const RectangleDef &region);
 
-        ~Sprite();
+        /**
+         * Create a sprite from a layer of a texture array, inheriting its width and height.
+         *
+         * @param texture_array Texture array for the sprite
+         * @param layer Layer of the texture array used to render the sprite
+         */
+        explicit Sprite(const TextureArray &texture_array, int layer);
+
+        /**
+         * Create a sprite from a region of a texture array layer.
+         *
+         * @param texture_array Texture array for the sprite
+         * @param layer Layer of the texture array used to render the sprite
+         * @param region Region of the layer used to render the sprite
+         */
+        explicit Sprite(const TextureArray &texture_array, int layer, const RectangleDef &region);
 
         /** Width of the sprite. */
         [[nodiscard]] int width() const;
@@ -177,6 +199,9 @@ namespace kex {
         ///@{
         /**
          * Retrieve a 3 x 3 column-major homogeneous transformation matrix in a flat array.
+         *
+         * Trigonometry is skipped for sprites without rotation.
+         *
          * @return Matrix representing the geometrical transformation of the sprite
          */
         [[nodiscard]] std::array<float, 3 * 3> transform() const;
@@ -185,9 +210,29 @@ namespace kex {
         /** @name Texture
          */
         ///@{
-        /** Texture for the sprite. */
+        /**
+         * Texture for the sprite.
+         *
+         * Only valid for sprites created from a texture, see is_layered().
+         */
         [[nodiscard]] const Texture &texture() const;
 
+        /**
+         * Texture array for the sprite.
+         *
+         * Only valid for sprites created from a texture array, see is_layered().
+         */
+        [[nodiscard]] const TextureArray &texture_array() const;
+
+        /** Flag indicating whether the sprite is rendered from a texture array layer. */
+        [[nodiscard]] bool is_layered() const;
+
+        /** Layer of the texture array used for rendering the sprite, 0 for regular textures. */
+        [[nodiscard]] int texture_layer() const;
+
+        /** Identifier of the texture or the texture array for the sprite. */
+        [[nodiscard]] unsigned int texture_id() const;
+
         /** Region of the texture used for rendering the sprite. */
         [[nodiscard]] const RectangleDef &texture_region() const;
 
@@ -202,12 +247,17 @@ namespace kex {
 
         /** End v-coordinate of the region within the texture */
         [[nodiscard]] float v_max() const;
+
+        /** Handle of the texture or the texture array for the sprite. */
+        [[nodiscard]] TextureHandle texture_handle() const;
+
+        /** Index of the region within the region table of the texture. */
+        [[nodiscard]] std::uint16_t region_index() const;
         ///@}
 
     private:
-        class Impl;
-
-        std::unique_ptr<Impl> impl;
+        TextureHandle handle;
+        std::uint16_t region;
     };
 
 }
@@ -19,16 +19,183 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef KEX_SPRITEBATCH_HPP
 #define KEX_SPRITEBATCH_HPP
 
+#include <cstddef>
 #include <memory>
 #include <kex/sprite.hpp>
+#include <kex/spritepool.hpp>
+#include <kex/camera.hpp>
 
 namespace kex {
 
+    /**
+     * Recorder of sprites to be drawn by a SpriteBatch.
+     *
+     * Unlike SpriteBatch, a recorder does not use OpenGL and can therefore be filled on any thread. Using one
+     * recorder per thread, sprites can be prepared in parallel without locking, even while other threads create
+     * sprites and textures:
+     * @code{.cpp}
+     * // Worker threads
+     * recorders[thread_index].clear();
+     * recorders[thread_index].add(sprite);
+     *
+     * // OpenGL thread, after the workers are done
+     * batch.begin();
+     * for (const auto &recorder: recorders) {
+     *     batch.submit(recorder);
+     * }
+     * batch.flush();
+     * @endcode
+     */
+    class SpriteRecorder {
+    public:
+        /**
+         * Create a recorder for batches with the specified transform mode.
+         *
+         * @param transform Where the transformation matrices of the recorded sprites are computed
+         */
+        explicit SpriteRecorder(SpriteTransform transform = SpriteTransform::CPU);
+
+        SpriteRecorder(SpriteRecorder &&recorder) noexcept;
+
+        SpriteRecorder &operator=(SpriteRecorder &&recorder) noexcept;
+
+        /**
+         * Discard all recorded sprites while keeping the allocated memory for reuse.
+         */
+        void clear();
+
+        /**
+         * Record a sprite.
+         *
+         * @param sprite Sprite to render
+         * @param layer Layer of the sprite in the range [-32768, 32767]
+         * @throws std::out_of_range if the layer is outside of the range
+         */
+        void add(const Sprite &sprite, int layer = 0);
+
+        /**
+         * Record all sprites of a pool.
+         *
+         * @param pool Pool of sprites to render
+         * @param layer Layer of the sprites in the range [-32768, 32767]
+         * @throws std::out_of_range if the layer is outside of the range
+         */
+        void add(const SpritePool &pool, int layer = 0);
+
+        ~SpriteRecorder();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+
+        friend class SpriteBatch;
+        friend class StaticSpriteBatch;
+    };
+
+    /**
+     * Batch of sprites rendered via instanced draw calls.
+     *
+     * A sprite batch is meant to be created once and reused every frame:
+     * @code{.cpp}
+     * kex::SpriteBatch batch;
+     * while (running) {
+     *     batch.begin();
+     *     batch.add(sprite);
+     *     batch.flush();
+     * }
+     * @endcode
+     *
+     * Memory used for staging sprite data is retained between frames, so a batch in a steady state does not allocate.
+     *
+     * Sprites are drawn with as few draw calls as possible: up to 16 different textures (or texture arrays) are bound
+     * to separate texture units and shared by a single draw call.
+     */
     class SpriteBatch {
     public:
-        SpriteBatch();
+        /**
+         * Create a sprite batch.
+         *
+         * @param transform Where the transformation matrices of sprites are computed
+         */
+        explicit SpriteBatch(SpriteTransform transform = SpriteTransform::CPU);
+
+        /**
+         * Start recording a new batch.
+         *
+         * All previously added sprites are discarded while the allocated staging memory is kept for reuse.
+         */
+        void begin();
+
+        /**
+         * Add a sprite to the batch.
+         *
+         * Sprites on lower layers are drawn first. Within a layer, sprites are grouped by their texture and
+         * drawn in the order they were added.
+         *
+         * @param sprite Sprite to render
+         * @param layer Layer of the sprite in the range [-32768, 32767]
+         * @throws std::out_of_range if the layer is outside of the range
+         */
+        void add(const Sprite &sprite, int layer = 0);
+
+        /**
+         * Add all sprites of a pool to the batch.
+         *
+         * Transforms of the pooled sprites are computed in bulk, directly into the staging memory of the batch.
+         * Within a layer, the sprites are drawn in the order of the pool.
+         *
+         * @param pool Pool of sprites to render
+         * @param layer Layer of the sprites in the range [-32768, 32767]
+         * @throws std::out_of_range if the layer is outside of the range
+         */
+        void add(const SpritePool &pool, int layer = 0);
+
+        /**
+         * Submit the sprites of a recorder to the batch.
+         *
+         * Recorded sprites are merged into the batch on the next flush(), in the order in which the recorders were
+         * submitted. The recorder must outlive that flush and must not be modified until then. Its transform mode must
+         * match the one of the batch, otherwise std::invalid_argument is thrown.
+         *
+         * @param recorder Recorder of sprites to render
+         */
+        void submit(const SpriteRecorder &recorder);
 
-        void add(const Sprite &sprite);
+        /**
+         * Upload and draw all sprites added since the last call to begin().
+         *
+         * @throws std::runtime_error if the instance buffer could not be mapped or an evicted texture could not be
+         * reloaded from its file
+         */
+        void flush();
+
+        /**
+         * Set the camera through which the sprites are viewed.
+         *
+         * The camera is applied on the GPU, so sprites do not need to be added again after it changes. Culling in add()
+         * uses the camera set at the time.
+         *
+         * @param camera Camera to use
+         */
+        void set_camera(const Camera &camera);
+
+        /**
+         * Enable or disable culling of invisible sprites, disabled by default.
+         *
+         * With culling enabled, add() drops sprites which are fully transparent, have zero area or lie entirely
+         * outside the logical viewport as seen through the camera. The check is conservative and uses the axis-aligned
+         * bounding box of the sprite. Pools and recorders are not culled.
+         *
+         * @param enabled Flag indicating whether invisible sprites are culled
+         */
+        void set_culling(bool enabled);
+
+        /** Number of sprites culled by add() since the last call to begin(). */
+        [[nodiscard]] std::size_t culled_sprites() const;
+
+        /** Number of sprites accepted by add() since the last call to begin(). */
+        [[nodiscard]] std::size_t accepted_sprites() const;
 
         ~SpriteBatch();
 
@@ -38,6 +205,60 @@ namespace kex {
         std::unique_ptr<Impl> impl;
     };
 
+
+    /**
+     * Batch of sprites uploaded once and drawn any number of times.
+     *
+     * Sprites are recorded by a SpriteRecorder and baked into static buffers on construction. Drawing does not touch
+     * the sprite data on the CPU, which suits layers that never change:
+     * @code{.cpp}
+     * kex::SpriteRecorder recorder;
+     * recorder.add(background);
+     * const kex::StaticSpriteBatch static_batch(recorder);
+     *
+     * while (running) {
+     *     static_batch.draw();
+     * }
+     * @endcode
+     *
+     * Later changes to the sprites or the recorder have no effect on the batch. The draw order follows the same rules
+     * as for SpriteBatch.
+     */
+    class StaticSpriteBatch {
+    public:
+        /**
+         * Create a static batch from recorded sprites.
+         *
+         * @param recorder Recorder of sprites to render, using the transform mode of the recorder
+         */
+        explicit StaticSpriteBatch(const SpriteRecorder &recorder);
+
+        StaticSpriteBatch(StaticSpriteBatch &&batch) noexcept;
+
+        StaticSpriteBatch &operator=(StaticSpriteBatch &&batch) noexcept;
+
+        /**
+         * Set the camera through which the sprites are viewed.
+         *
+         * @param camera Camera to use
+         */
+        void set_camera(const Camera &camera);
+
+        /**
+         * Draw all sprites of the batch.
+         *
+         * @throws std::runtime_error if an evicted texture could not be reloaded from its file
+         */
+        void draw() const;
+
+        ~StaticSpriteBatch();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+    };
+
 }
 
 #endif //KEX_SPRITEBATCH_HPP
@@ -0,0 +1,115 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_SPRITEGRID_HPP
+#define KEX_SPRITEGRID_HPP
+
+#include <cstddef>
+#include <memory>
+#include <kex/sprite.hpp>
+#include <kex/spritebatch.hpp>
+#include <kex/def.hpp>
+
+namespace kex {
+
+    /**
+     * Spatial index of sprites based on a uniform grid.
+     *
+     * Each sprite is stored in the cell containing its center, so only the cells around a view rectangle are visited
+     * when querying visible sprites. Sprites larger than a cell are kept aside and tested individually.
+     * @code{.cpp}
+     * kex::SpriteGrid grid;
+     * grid.insert(sprite);
+     *
+     * // After changing the position, rotation, scale or shear of the sprite
+     * grid.move(sprite);
+     *
+     * batch.begin();
+     * grid.query({camera_x, camera_y, kex::logical_viewport_w, kex::logical_viewport_h}, batch);
+     * batch.flush();
+     * @endcode
+     *
+     * The grid refers to the inserted sprites, which must outlive it or be removed first. Sprites of the same layer and
+     * texture are drawn in the order of the grid rather than the order of insertion.
+     */
+    class SpriteGrid {
+    public:
+        /**
+         * Create an empty grid.
+         *
+         * @param cell_size Width and height of a grid cell
+         */
+        explicit SpriteGrid(float cell_size = 256.f);
+
+        SpriteGrid(SpriteGrid &&grid) noexcept;
+
+        SpriteGrid &operator=(SpriteGrid &&grid) noexcept;
+
+        /**
+         * Insert a sprite into the grid.
+         *
+         * @param sprite Sprite to insert
+         * @param layer Layer of the sprite in the range [-32768, 32767]
+         * @throws std::invalid_argument if the sprite is already in the grid or its position is not finite
+         * @throws std::out_of_range if the layer is outside of the range
+         */
+        void insert(const Sprite &sprite, int layer = 0);
+
+        /**
+         * Update the location of a sprite in the grid after its transform changed.
+         *
+         * @param sprite Previously inserted sprite
+         * @throws std::invalid_argument if the sprite is not in the grid or its position is not finite
+         */
+        void move(const Sprite &sprite);
+
+        /**
+         * Remove a sprite from the grid.
+         *
+         * @param sprite Previously inserted sprite
+         */
+        void remove(const Sprite &sprite);
+
+        /**
+         * Remove all sprites from the grid.
+         */
+        void clear();
+
+        /** Number of sprites in the grid. */
+        [[nodiscard]] std::size_t size() const;
+
+        /**
+         * Add all sprites overlapping a rectangle to a batch.
+         *
+         * @param view Rectangle in pixel coordinates, e.g. the visible part of the world
+         * @param batch Batch to add the sprites to
+         * @return Number of added sprites
+         */
+        std::size_t query(const RectangleDef &view, SpriteBatch &batch) const;
+
+        ~SpriteGrid();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+    };
+
+}
+
+#endif //KEX_SPRITEGRID_HPP
@@ -0,0 +1,178 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_SPRITEPOOL_HPP
+#define KEX_SPRITEPOOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <kex/texture.hpp>
+#include <kex/def.hpp>
+
+namespace kex {
+
+    struct SpriteInstance;
+
+    /**
+     * Pool of sprites sharing a texture, stored as a structure of arrays.
+     *
+     * Every property of the pooled sprites is kept in its own contiguous array, which makes updating many sprites at
+     * once (e.g. particles) cache-friendly:
+     * @code{.cpp}
+     * // extern kex::SpritePool pool;
+     * auto *y = pool.y();
+     * for (std::size_t i = 0; i < pool.size(); ++i) {
+     *     y[i] += speed;
+     * }
+     * @endcode
+     *
+     * Properties have the same meaning as the members of Sprite. Each sprite renders one of the regions of the
+     * texture, selected by its region index. Transforms of the whole pool are computed with SIMD instructions
+     * (SSE2, NEON or WebAssembly SIMD, whichever is available) when the pool is added to a SpriteBatch.
+     */
+    class SpritePool {
+    public:
+        /**
+         * Create an empty pool of sprites rendered from a texture.
+         *
+         * The region with the index 0 covers the whole texture.
+         *
+         * @param texture Texture for the sprites
+         */
+        explicit SpritePool(const Texture &texture);
+
+        SpritePool(SpritePool &&pool) noexcept;
+
+        SpritePool &operator=(SpritePool &&pool) noexcept;
+
+        /**
+         * Add a texture region the sprites can be rendered from.
+         *
+         * @param region Region of the texture
+         * @return Index of the region
+         */
+        int add_region(const RectangleDef &region);
+
+        /**
+         * Add a sprite with the default rotation, scale, shear and tint.
+         *
+         * @param x x-coordinate of the center of the sprite
+         * @param y y-coordinate of the center of the sprite
+         * @param region Index of the texture region used to render the sprite
+         * @return Index of the sprite
+         * @throws std::out_of_range if there is no region with the index
+         */
+        std::size_t add(float x, float y, int region = 0);
+
+        /**
+         * Remove a sprite by moving the last sprite into its place.
+         *
+         * @param index Index of the sprite to remove
+         * @throws std::out_of_range if there is no sprite with the index
+         */
+        void remove(std::size_t index);
+
+        /**
+         * Remove all sprites while keeping the allocated memory for reuse.
+         */
+        void clear();
+
+        /**
+         * Allocate memory for the specified number of sprites.
+         *
+         * @param capacity Number of sprites
+         */
+        void reserve(std::size_t capacity);
+
+        /** Number of sprites in the pool. */
+        [[nodiscard]] std::size_t size() const;
+
+        /** Texture for the sprites. */
+        [[nodiscard]] const Texture &texture() const;
+
+        /**
+         * Set the tint color of a sprite.
+         *
+         * @param index Index of the sprite
+         * @param r Red component of the tint color
+         * @param g Green component of the tint color
+         * @param b Blue component of the tint color
+         * @param a Alpha component of the tint color
+         */
+        void set_tint(std::size_t index, float r, float g, float b, float a = 1.f);
+
+        /**
+         * Pack a tint color into the format of the tint() array.
+         *
+         * @param r Red component of the tint color
+         * @param g Green component of the tint color
+         * @param b Blue component of the tint color
+         * @param a Alpha component of the tint color
+         * @return RGBA8 color, with the red component at the lowest address
+         */
+        static std::uint32_t pack_tint(float r, float g, float b, float a = 1.f);
+
+        /** @name Arrays
+         *  Arrays of sprite properties, each holding size() elements.
+         *  Pointers are invalidated by adding sprites to the pool.
+         */
+        ///@{
+        /** x-coordinates of the centers of the sprites. */
+        float *x();
+
+        /** y-coordinates of the centers of the sprites. */
+        float *y();
+
+        /** Counterclockwise (CCW) rotations around the centers in radians. */
+        float *rotation();
+
+        /** Scale factors in the x-axis direction. */
+        float *scale_x();
+
+        /** Scale factors in the y-axis direction. */
+        float *scale_y();
+
+        /** Shear factors in the x-axis direction. */
+        float *shear_x();
+
+        /** Shear factors in the y-axis direction. */
+        float *shear_y();
+
+        /** Tint colors, packed by pack_tint(). */
+        std::uint32_t *tint();
+
+        /** Indices of the texture regions, each returned by add_region() or 0. */
+        int *region();
+        ///@}
+
+        ~SpritePool();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+
+        void write_instances(SpriteInstance *instances, SpriteTransform transform) const;
+
+        friend struct SpriteRecording;
+    };
+
+}
+
+#endif //KEX_SPRITEPOOL_HPP
@@ -0,0 +1,94 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_STATE_HPP
+#define KEX_STATE_HPP
+
+namespace kex {
+
+    /**
+     * Cache of the OpenGL state changed by Kex.
+     *
+     * All Kex objects bind programs, vertex arrays, buffers and textures and change blending through this cache,
+     * which drops calls that would not change the current state.
+     *
+     * @verbatim embed:rst:leading-asterisk
+     * .. note::
+     *    The cache only knows about state changed through Kex. After changing the same OpenGL state directly,
+     *    a user must call :cpp:func:`kex::StateCache::invalidate`.
+     * @endverbatim
+     */
+    class StateCache {
+    public:
+        StateCache() = delete;
+
+        /**
+         * Forget the cached state so that the next state change of each kind reaches OpenGL.
+         */
+        static void invalidate();
+
+        /** Number of OpenGL calls skipped because they would not change the state. */
+        [[nodiscard]] static unsigned long long skipped_calls();
+
+        /** Reset the counter of skipped OpenGL calls. */
+        static void reset_skipped_calls();
+
+        /** @name State changes
+         *  Wrappers for the corresponding OpenGL calls.
+         */
+        ///@{
+        static void use_program(unsigned int id);
+
+        static void bind_vertex_array(unsigned int id);
+
+        static void bind_buffer(unsigned int target, unsigned int id);
+
+        [[nodiscard]] static bool is_buffer_bound(unsigned int target, unsigned int id);
+
+        static void bind_texture(unsigned int target, unsigned int id, unsigned int unit = 0);
+
+        /**
+         * Make a texture unit active. Binding a texture that is already bound to its unit does not change the
+         * active unit, so this is required before modifying a bound texture.
+         */
+        static void active_texture(unsigned int unit);
+
+        static void set_uniform(int location, int value);
+
+        static void set_blend(bool enabled);
+
+        static void set_blend_func(unsigned int source_factor, unsigned int destination_factor);
+        ///@}
+
+        /** @name Object deletion
+         *  Notify the cache that an object has been deleted, as its identifier may be reused.
+         */
+        ///@{
+        static void forget_program(unsigned int id);
+
+        static void forget_vertex_array(unsigned int id);
+
+        static void forget_buffer(unsigned int id);
+
+        static void forget_texture(unsigned int id);
+        ///@}
+    };
+
+}
+
+#endif //KEX_STATE_HPP
@@ -20,29 +20,59 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define KEX_TEXTURE_HPP
 
 #include <string>
+#include <vector>
 #include <memory>
+#include <cstdint>
 
 namespace kex {
 
+    /**
+     * Small identifier of a live texture or texture array, used by sprites to refer to their texture.
+     */
+    using TextureHandle = std::uint16_t;
+
+    class AtlasFile;
+
+    class KtxFile;
+
     class Texture {
     public:
         /**
          * Load a texture from an image file.
          *
+         * Binary atlas files (see TextureAtlas) are memory-mapped and uploaded without decoding, together with their
+         * precomputed mipmap if they hold one. KTX 1 and KTX 2 files compressed with ETC2 or EAC stay compressed in
+         * video memory. Their mipmap can only come from the file, so @p mipmap has no effect on them.
+         *
          * @param path Path to the texture image file
          * @param mipmap Flag indicating whether to generate a texture mipmap
          */
         explicit Texture(const std::string &path, bool mipmap = false);
 
+        /**
+         * Create a texture from pixels in memory.
+         *
+         * @param pixels RGBA pixels with 8 bits per channel, starting with the top row of the image
+         * @param width Width of the image in pixels
+         * @param height Height of the image in pixels
+         * @param mipmap Flag indicating whether to generate a texture mipmap
+         */
+        explicit Texture(const unsigned char *pixels, int width, int height, bool mipmap = false);
+
         /**
          * Bind the current texture for rendering.
+         *
+         * @param unit Texture unit to bind the texture to
          */
-        void bind() const;
+        void bind(unsigned int unit = 0) const;
 
         /**
          * Bind the texture with the specified identifier for rendering.
+         *
+         * @param id Texture identifier
+         * @param unit Texture unit to bind the texture to
          */
-        static void bind(unsigned int id);
+        static void bind(unsigned int id, unsigned int unit = 0);
 
         /** Width of the texture in pixels. */
         [[nodiscard]] int width() const;
@@ -53,8 +83,103 @@ namespace kex {
         /** Texture identifier. */
         [[nodiscard]] unsigned int id() const;
 
+        /** Handle of the texture. */
+        [[nodiscard]] TextureHandle handle() const;
+
+        /**
+         * Whether the first row of the texture is the top row of the image, as in KTX files, rather than the bottom
+         * one. Texture coordinates of sprites account for it.
+         */
+        [[nodiscard]] bool is_top_down() const;
+
         ~Texture();
 
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+
+        /** Create a transparent placeholder of the specified size, whose pixels are loaded from @p path later. */
+        Texture(const std::string &path, int width, int height, bool mipmap);
+
+        /**
+         * Replace the pixels of the texture with rows in the bottom-up order of OpenGL. If a pixel unpack buffer is
+         * bound, @p rows is an offset into it.
+         */
+        void upload_rows(const void *rows, int width, int height, bool mipmap) const;
+
+        /** Replace the pixels of the texture with the levels of a binary atlas file. */
+        void upload(const AtlasFile &file, bool mipmap) const;
+
+        /** Replace the pixels of the texture with the compressed levels of a KTX file. */
+        void upload(const KtxFile &file) const;
+
+        /** Update the registry after the pixels were replaced, possibly changing the size or orientation. */
+        void uploaded(int previous_width, int previous_height, bool previous_top_down) const;
+
+        /** Release the video memory of the texture, keeping its identifier. */
+        void evict() const;
+
+        /** Load the pixels of an evicted texture from its file again. */
+        void reload() const;
+
+        /** File the texture is loaded from, or an empty path if it was created from pixels in memory. */
+        [[nodiscard]] const std::string &source_path() const;
+
+        /** Whether a mipmap is generated when the texture is loaded from its file. */
+        [[nodiscard]] bool source_mipmap() const;
+
+        friend class TextureLoader;
+        friend class TextureRegistry;
+    };
+
+    /**
+     * Array of equally sized textures, sampled as a single texture with multiple layers.
+     *
+     * Sprites drawn from any layer of the same texture array can be rendered with a single draw call.
+     */
+    class TextureArray {
+    public:
+        /**
+         * Load a texture array from image files, one layer per image.
+         *
+         * @param paths Paths to the image files, all of which must have the same dimensions
+         * @param mipmap Flag indicating whether to generate a texture mipmap
+         */
+        explicit TextureArray(const std::vector<std::string> &paths, bool mipmap = false);
+
+        /**
+         * Bind the current texture array for rendering.
+         *
+         * @param unit Texture unit to bind the texture array to
+         */
+        void bind(unsigned int unit = 0) const;
+
+        /**
+         * Bind the texture array with the specified identifier for rendering.
+         *
+         * @param id Texture array identifier
+         * @param unit Texture unit to bind the texture array to
+         */
+        static void bind(unsigned int id, unsigned int unit = 0);
+
+        /** Width of each layer in pixels. */
+        [[nodiscard]] int width() const;
+
+        /** Height of each layer in pixels. */
+        [[nodiscard]] int height() const;
+
+        /** Number of layers. */
+        [[nodiscard]] int layers() const;
+
+        /** Texture identifier. */
+        [[nodiscard]] unsigned int id() const;
+
+        /** Handle of the texture array. */
+        [[nodiscard]] TextureHandle handle() const;
+
+        ~TextureArray();
+
     private:
         class Impl;
 
@@ -0,0 +1,87 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_TEXTURECACHE_HPP
+#define KEX_TEXTURECACHE_HPP
+
+#include <cstddef>
+
+namespace kex {
+
+    /**
+     * Budget for the video memory of textures, which evicts the least recently used textures when it is exceeded.
+     *
+     * A texture is used when a sprite batch draws it. Textures are evicted by next_frame(), least recently used first,
+     * but never while they are drawn in the current frame. Textures loaded from files are reloaded when a sprite
+     * batch draws them after their eviction. Without a TextureLoader, the draw reloads them right away, which stalls
+     * it while the files are decoded. While a TextureLoader is alive, the draw queues them instead, the loader decodes
+     * them on its worker threads and its update() uploads them, so they are transparent for a few frames. Textures
+     * created from pixels in memory and texture arrays count towards the budget but are never evicted.
+     * @code{.cpp}
+     * kex::TextureCache::set_budget(256 * 1024 * 1024);
+     *
+     * // Every frame
+     * kex::TextureCache::next_frame();
+     * batch.begin();
+     * batch.add(player);
+     * batch.flush();
+     * @endcode
+     *
+     * @verbatim embed:rst:leading-asterisk
+     * .. note::
+     *    While a TextureLoader is alive, evicted textures stay transparent until its update() is called. Without
+     *    calls to next_frame(), no texture is evicted once the budget is set.
+     *    An evicted texture which is bound directly rather than drawn by a sprite batch is transparent.
+     *    All functions must be called on the thread of the OpenGL context.
+     * @endverbatim
+     */
+    class TextureCache {
+    public:
+        TextureCache() = delete;
+
+        /**
+         * Set the budget, evicting textures not drawn in the current frame right away if they exceed it.
+         *
+         * @param bytes Number of bytes of video memory for textures, or 0 for no budget
+         */
+        static void set_budget(std::size_t bytes);
+
+        /**
+         * Start a new frame, evicting the least recently used textures if the resident ones exceed the budget.
+         *
+         * Textures drawn in the frame that ends here become candidates for eviction, so this must be called once per
+         * frame rather than once per sprite batch.
+         */
+        static void next_frame();
+
+        /** Number of bytes of video memory for textures, or 0 if there is no budget. */
+        static std::size_t budget();
+
+        /** Number of bytes of video memory taken by the textures which are currently resident. */
+        static std::size_t resident_bytes();
+
+        /** Number of evicted textures so far. */
+        static std::size_t evictions();
+
+        /** Number of textures reloaded after their eviction so far. */
+        static std::size_t reloads();
+    };
+
+}
+
+#endif //KEX_TEXTURECACHE_HPP
@@ -0,0 +1,111 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_TEXTURELOADER_HPP
+#define KEX_TEXTURELOADER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <kex/texture.hpp>
+
+namespace kex {
+
+    /**
+     * Loader of textures which decodes images on a pool of worker threads.
+     *
+     * A loaded texture can be used right away. It is transparent until its pixels are uploaded by update(), which
+     * uploads only as many textures per call as the budget allows, so that loading does not stall rendering.
+     *
+     * Workers decode images and copy them into pixel unpack buffers mapped on the OpenGL thread, flipping their rows
+     * during the copy, so update() only issues the uploads. The buffers are reused, and only a few images per worker
+     * hold one at a time.
+     * @code{.cpp}
+     * kex::TextureLoader loader;
+     * const auto texture = loader.load("player.png");
+     * kex::Sprite player(*texture);
+     *
+     * // Every frame
+     * loader.update();
+     * batch.begin();
+     * batch.add(player);
+     * batch.flush();
+     * @endcode
+     *
+     * @verbatim embed:rst:leading-asterisk
+     * .. note::
+     *    All member functions must be called on the thread of the OpenGL context.
+     * @endverbatim
+     */
+    class TextureLoader {
+    public:
+        /**
+         * Create a loader and start its worker threads.
+         *
+         * @param threads Number of worker threads, or 0 to use one less than the number of hardware threads, but at
+         * least one
+         */
+        explicit TextureLoader(unsigned int threads = 0);
+
+        /**
+         * Start loading a texture from an image, binary atlas or KTX file.
+         *
+         * Only the header of an image is read on the calling thread to find the size of the texture. Atlas and KTX
+         * files are validated on the calling thread and read into memory by a worker thread, since their pixels need
+         * no decoding.
+         *
+         * @param path Path to the texture image, atlas or KTX file
+         * @param mipmap Flag indicating whether to generate a texture mipmap, which KTX files ignore
+         * @return Texture which is transparent until its pixels are uploaded
+         * @throws std::runtime_error if the file does not exist or is not a supported image, atlas or KTX file
+         */
+        std::shared_ptr<Texture> load(const std::string &path, bool mipmap = false);
+
+        /**
+         * Upload decoded textures.
+         *
+         * Evicted textures that were drawn since the last call (see TextureCache) are queued for reloading first. At
+         * least one decoded texture is uploaded per call, if there is any, and more while neither budget is
+         * exhausted. Textures that were destroyed in the meantime are skipped.
+         *
+         * @param time_budget Time after which no more textures are uploaded
+         * @param byte_budget Number of bytes after which no more textures are uploaded
+         * @return Number of uploaded textures
+         * @throws std::runtime_error if an image could not be decoded
+         */
+        std::size_t update(std::chrono::microseconds time_budget = std::chrono::milliseconds(2),
+                           std::size_t byte_budget = 16 * 1024 * 1024);
+
+        /** Number of loaded or reloaded textures which are not uploaded yet. */
+        [[nodiscard]] std::size_t pending() const;
+
+        /**
+         * Stop the worker threads. Textures which are not uploaded yet stay transparent.
+         */
+        ~TextureLoader();
+
+    private:
+        class Impl;
+
+        std::unique_ptr<Impl> impl;
+    };
+
+}
+
+#endif //KEX_TEXTURELOADER_HPP
@@ -25,9 +25,15 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 namespace kex {
 
     enum VertexAttr {
+        FLOAT,
+        FLOAT_USHORT,
         VEC2,
+        VEC2_HALF,
         VEC4,
+        VEC4_UBYTE,
+        VEC4_USHORT,
         MAT3,
+        MAT3X2,
     };
 
     class VertexArray {
@@ -41,7 +47,10 @@ namespace kex {
         void bind() const;
 
         template<VertexAttr Attr, int Div = 0, bool Norm = false, BufferUsage Usg>
-        void add_attribute(const ArrayBuffer<Usg> &array_buffer);
+        void add_attribute(const ArrayBuffer<Usg> &array_buffer, int stride = 0, int offset = 0);
+
+        template<BufferUsage Usg>
+        void rebase(const ArrayBuffer<Usg> &array_buffer, int base_offset);
 
         ~VertexArray();
 
@@ -0,0 +1,385 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include <kex/atlas.hpp>
+
+#include "atlasfile.hpp"
+
+#include <stb_image.h>
+
+namespace kex {
+
+    using ImageData = std::unique_ptr<unsigned char, decltype(&stbi_image_free)>;
+
+    /**
+     * Skyline bottom-left packer of rectangles into a fixed area.
+     *
+     * The skyline is the upper outline of the packed rectangles, stored as horizontal segments sorted by x. Each
+     * rectangle is placed on the segment where its bottom edge ends up the lowest.
+     */
+    class SkylinePacker {
+    public:
+        SkylinePacker(int width, int height) : width(width), height(height), skyline{{0, 0, width}} {}
+
+        bool insert(int w, int h, int &x, int &y) {
+            auto best_index = skyline.size();
+            auto best_bottom = std::numeric_limits<int>::max();
+            auto best_width = std::numeric_limits<int>::max();
+            for (std::size_t i = 0; i < skyline.size() && skyline[i].x + w <= width; ++i) {
+                const auto top = fit(i, w);
+                const auto bottom = top + h;
+                if (bottom > height) continue;
+                if (bottom < best_bottom || (bottom == best_bottom && skyline[i].w < best_width)) {
+                    best_index = i;
+                    best_bottom = bottom;
+                    best_width = skyline[i].w;
+                }
+            }
+            if (best_index == skyline.size()) return false;
+
+            x = skyline[best_index].x;
+            y = best_bottom - h;
+            raise(best_index, {x, best_bottom, w});
+            return true;
+        }
+
+    private:
+        struct Segment {
+            int x, y, w;
+        };
+
+        const int width;
+        const int height;
+        std::vector<Segment> skyline;
+
+        /** Lowest y-coordinate at which a rectangle of width @p w fits when placed at the start of segment @p i. */
+        [[nodiscard]] int fit(std::size_t i, int w) const {
+            const auto end = skyline[i].x + w;
+            auto top = 0;
+            for (auto j = i; j < skyline.size() && skyline[j].x < end; ++j) {
+                top = std::max(top, skyline[j].y);
+            }
+            return top;
+        }
+
+        void raise(std::size_t i, const Segment &segment) {
+            skyline.insert(skyline.begin() + static_cast<std::ptrdiff_t>(i), segment);
+
+            // Cut the segments covered by the new one
+            const auto end = segment.x + segment.w;
+            while (i + 1 < skyline.size() && skyline[i + 1].x < end) {
+                auto &next = skyline[i + 1];
+                const auto covered = end - next.x;
+                if (covered < next.w) {
+                    next.x += covered;
+                    next.w -= covered;
+                    break;
+                }
+                skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+            }
+
+            // Merge neighbouring segments at the same height
+            for (std::size_t j = 0; j + 1 < skyline.size();) {
+                if (skyline[j].y == skyline[j + 1].y) {
+                    skyline[j].w += skyline[j + 1].w;
+                    skyline.erase(skyline.begin() + static_cast<std::ptrdiff_t>(j + 1));
+                } else {
+                    ++j;
+                }
+            }
+        }
+    };
+
+    class AtlasBuilder::Impl {
+    public:
+        Impl(int max_size, int padding) : max_size(max_size), padding(padding) {
+            if (max_size <= 0 || padding < 0) {
+                throw std::invalid_argument("Invalid atlas size or padding.");
+            }
+        }
+
+        void add(const std::string &name, const unsigned char *pixels, int width, int height) {
+            if (indices.count(name) != 0) {
+                throw std::invalid_argument(name + " is already in the atlas.");
+            }
+            if (width <= 0 || height <= 0) {
+                throw std::invalid_argument(name + " has no pixels.");
+            }
+            indices.emplace(name, images.size());
+            images.push_back({name, width, height, {pixels, pixels + static_cast<std::size_t>(width) * height * 4}});
+        }
+
+        void add(const std::string &name, const ImageData &data, int width, int height) {
+            if (data == nullptr) {
+                throw std::runtime_error("Could not load " + name + " into the atlas");
+            }
+            add(name, data.get(), width, height);
+        }
+
+        [[nodiscard]] std::size_t size() const { return images.size(); }
+
+        [[nodiscard]] AtlasImage compose() const {
+            if (images.empty()) {
+                throw std::runtime_error("No images were added to the atlas.");
+            }
+
+            // Tall images first, which keeps the skyline flat
+            std::vector<std::size_t> order(images.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+                if (images[a].height != images[b].height) return images[a].height > images[b].height;
+                return images[a].width > images[b].width;
+            });
+
+            // Start with the smallest power-of-two atlas that could hold all images and grow it until they fit
+            std::size_t area = 0;
+            int max_w = 1, max_h = 1;
+            for (const auto &image: images) {
+                area += static_cast<std::size_t>(image.width + 2 * padding) * (image.height + 2 * padding);
+                max_w = std::max(max_w, image.width + 2 * padding);
+                max_h = std::max(max_h, image.height + 2 * padding);
+            }
+            int width = 1, height = 1;
+            while (width < max_w) width *= 2;
+            while (height < max_h) height *= 2;
+            while (static_cast<std::size_t>(width) * height < area) {
+                (width <= height ? width : height) *= 2;
+            }
+
+            std::vector<RectangleDef> placements(images.size());
+            while (!pack(order, width, height, placements)) {
+                (width <= height ? width : height) *= 2;
+            }
+
+            AtlasImage atlas;
+            atlas.width = width;
+            atlas.height = height;
+            atlas.pixels.resize(static_cast<std::size_t>(width) * height * 4);
+            atlas.regions.reserve(images.size());
+            for (std::size_t i = 0; i < images.size(); ++i) {
+                blit(images[i], placements[i], atlas);
+                atlas.regions.push_back({images[i].name, placements[i]});
+            }
+            return atlas;
+        }
+
+    private:
+        struct Image {
+            std::string name;
+            int width, height;
+            std::vector<unsigned char> pixels;
+        };
+
+        const int max_size;
+        const int padding;
+        std::vector<Image> images;
+        std::unordered_map<std::string, std::size_t> indices;
+
+        bool pack(const std::vector<std::size_t> &order, int width, int height,
+                  std::vector<RectangleDef> &placements) const {
+            if (width > max_size || height > max_size) {
+                throw std::runtime_error("Images do not fit into an atlas of the maximum size.");
+            }
+
+            SkylinePacker packer(width, height);
+            for (const auto i: order) {
+                const auto &image = images[i];
+                int x, y;
+                if (!packer.insert(image.width + 2 * padding, image.height + 2 * padding, x, y)) return false;
+                placements[i] = {x + padding, y + padding, image.width, image.height};
+            }
+            return true;
+        }
+
+        void blit(const Image &image, const RectangleDef &region, AtlasImage &atlas) const {
+            const auto pixel_at = [&atlas](int x, int y) {
+                return atlas.pixels.data() + (static_cast<std::size_t>(y) * atlas.width + x) * 4;
+            };
+            const auto row_size = static_cast<std::size_t>(image.width) * 4;
+            for (int row = 0; row < image.height; ++row) {
+                std::memcpy(pixel_at(region.x, region.y + row), image.pixels.data() + row_size * row, row_size);
+            }
+
+            // Repeat the edges into the padding so that filtering does not bleed in neighbouring images
+            for (int row = 1; row <= padding; ++row) {
+                std::memcpy(pixel_at(region.x, region.y - row), pixel_at(region.x, region.y), row_size);
+                std::memcpy(pixel_at(region.x, region.y + region.h - 1 + row),
+                            pixel_at(region.x, region.y + region.h - 1), row_size);
+            }
+            for (int row = region.y - padding; row < region.y + region.h + padding; ++row) {
+                for (int column = 1; column <= padding; ++column) {
+                    std::memcpy(pixel_at(region.x - column, row), pixel_at(region.x, row), 4);
+                    std::memcpy(pixel_at(region.x + region.w - 1 + column, row), pixel_at(region.x + region.w - 1, row),
+                                4);
+                }
+            }
+        }
+    };
+
+    AtlasBuilder::AtlasBuilder(int max_size, int padding) : impl(std::make_unique<Impl>(max_size, padding)) {}
+
+    void AtlasBuilder::add(const std::string &name, const std::string &path) {
+        if (!std::filesystem::exists(path)) {
+            throw std::runtime_error(path + " does not exist.");
+        }
+
+        int width, height, n_original_channels;
+        stbi_set_flip_vertically_on_load(false);
+        const ImageData data(stbi_load(path.c_str(), &width, &height, &n_original_channels, 4), stbi_image_free);
+        impl->add(name, data, width, height);
+    }
+
+    void AtlasBuilder::add_encoded(const std::string &name, const unsigned char *data, std::size_t size) {
+        if (size > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+            throw std::invalid_argument(name + " is too large.");
+        }
+
+        int width, height, n_original_channels;
+        stbi_set_flip_vertically_on_load(false);
+        const ImageData decoded(
+                stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &n_original_channels, 4),
+                stbi_image_free);
+        impl->add(name, decoded, width, height);
+    }
+
+    void AtlasBuilder::add_pixels(const std::string &name, const unsigned char *pixels, int width, int height) {
+        impl->add(name, pixels, width, height);
+    }
+
+    std::size_t AtlasBuilder::size() const { return impl->size(); }
+
+    AtlasImage AtlasBuilder::compose() const { return impl->compose(); }
+
+    TextureAtlas AtlasBuilder::build(bool mipmap) const { return TextureAtlas(compose(), mipmap); }
+
+    AtlasBuilder::~AtlasBuilder() = default;
+
+    /**
+     * Halve an image by averaging blocks of 2x2 pixels, repeating the last row or column of odd sizes.
+     */
+    static std::vector<unsigned char> downsample(const std::vector<unsigned char> &pixels, std::uint32_t width,
+                                                 std::uint32_t height) {
+        const auto half_width = level_size(width, 1);
+        const auto half_height = level_size(height, 1);
+        std::vector<unsigned char> half(static_cast<std::size_t>(half_width) * half_height * 4);
+        for (std::uint32_t y = 0; y < half_height; ++y) {
+            const auto y0 = std::min(2 * y, height - 1);
+            const auto y1 = std::min(2 * y + 1, height - 1);
+            for (std::uint32_t x = 0; x < half_width; ++x) {
+                const auto x0 = std::min(2 * x, width - 1);
+                const auto x1 = std::min(2 * x + 1, width - 1);
+                for (std::uint32_t channel = 0; channel < 4; ++channel) {
+                    const auto at = [&](std::uint32_t px, std::uint32_t py) {
+                        return static_cast<unsigned>(pixels[(static_cast<std::size_t>(py) * width + px) * 4 + channel]);
+                    };
+                    const auto sum = at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1);
+                    half[(static_cast<std::size_t>(y) * half_width + x) * 4 + channel] =
+                            static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        return half;
+    }
+
+    void AtlasImage::save(const std::string &path, bool mipmap) const {
+        const auto file_width = static_cast<std::uint32_t>(width);
+        const auto file_height = static_cast<std::uint32_t>(height);
+
+        // OpenGL expects the bottom row first
+        std::vector<std::vector<unsigned char>> levels(1);
+        const auto row_size = static_cast<std::size_t>(width) * 4;
+        levels[0].resize(row_size * height);
+        for (int row = 0; row < height; ++row) {
+            std::memcpy(levels[0].data() + row_size * (height - 1 - row), pixels.data() + row_size * row, row_size);
+        }
+        for (std::uint32_t level = 1; mipmap && (level_size(file_width, level - 1) > 1 ||
+                                                 level_size(file_height, level - 1) > 1); ++level) {
+            levels.push_back(downsample(levels.back(), level_size(file_width, level - 1),
+                                        level_size(file_height, level - 1)));
+        }
+
+        std::vector<AtlasFileRegion> file_regions;
+        file_regions.reserve(regions.size());
+        for (const auto &[name, rectangle]: regions) {
+            file_regions.push_back({hash_name(name), rectangle.x, rectangle.y, rectangle.w, rectangle.h});
+        }
+        AtlasFile::write(path, file_width, file_height, levels, std::move(file_regions));
+    }
+
+    class TextureAtlas::Impl {
+    public:
+        Impl(const AtlasImage &image, bool mipmap) : texture(image.pixels.data(), image.width, image.height, mipmap) {
+            for (const auto &[name, rectangle]: image.regions) {
+                add(hash_name(name), rectangle);
+            }
+        }
+
+        Impl(const std::string &path, bool mipmap) : texture(path, mipmap) {
+            const AtlasFile file(path);
+            const auto *file_regions = file.regions();
+            for (std::uint32_t i = 0; i < file.header().regions; ++i) {
+                const auto &region = file_regions[i];
+                add(region.name_hash, {region.x, region.y, region.w, region.h});
+            }
+        }
+
+        Texture texture;
+
+        /** Regions by the hashes of their names. */
+        std::unordered_map<std::uint64_t, RectangleDef> regions;
+
+    private:
+        void add(std::uint64_t name_hash, const RectangleDef &rectangle) {
+            if (!regions.emplace(name_hash, rectangle).second) {
+                throw std::runtime_error("Names of two atlas regions have the same hash.");
+            }
+        }
+    };
+
+    TextureAtlas::TextureAtlas(const AtlasImage &image, bool mipmap) : impl(std::make_unique<Impl>(image, mipmap)) {}
+
+    TextureAtlas::TextureAtlas(const std::string &path, bool mipmap) : impl(std::make_unique<Impl>(path, mipmap)) {}
+
+    TextureAtlas::TextureAtlas(TextureAtlas &&atlas) noexcept = default;
+
+    TextureAtlas &TextureAtlas::operator=(TextureAtlas &&atlas) noexcept = default;
+
+    const Texture &TextureAtlas::texture() const { return impl->texture; }
+
+    bool TextureAtlas::contains(const std::string &name) const { return impl->regions.count(hash_name(name)) != 0; }
+
+    const RectangleDef &TextureAtlas::region(const std::string &name) const {
+        const auto it = impl->regions.find(hash_name(name));
+        if (it == impl->regions.end()) {
+            throw std::out_of_range(name + " is not in the atlas.");
+        }
+        return it->second;
+    }
+
+    Sprite TextureAtlas::sprite(const std::string &name) const { return Sprite(impl->texture, region(name)); }
+
+    TextureAtlas::~TextureAtlas() = default;
+
+}
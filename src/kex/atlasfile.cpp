@@ -0,0 +1,112 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "atlasfile.hpp"
+
+namespace kex {
+
+    std::uint64_t hash_name(const std::string &name) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const auto c: name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    AtlasFile::AtlasFile(const std::string &path) : file(path) {
+        if (file.size() < sizeof(AtlasFileHeader) ||
+            std::memcmp(header().magic, ATLAS_FILE_MAGIC, sizeof(ATLAS_FILE_MAGIC)) != 0) {
+            throw std::runtime_error(path + " is not an atlas file.");
+        }
+
+        const auto &info = header();
+        if (info.version != ATLAS_FILE_VERSION) {
+            throw std::runtime_error(path + " has an unsupported atlas file version.");
+        }
+        if (info.width == 0 || info.height == 0 || info.levels == 0 || info.levels > 32) {
+            throw std::runtime_error(path + " has invalid atlas dimensions.");
+        }
+
+        // Locate the mip levels and make sure they are all within the file
+        auto offset = sizeof(AtlasFileHeader) + static_cast<std::size_t>(info.regions) * sizeof(AtlasFileRegion);
+        for (std::uint32_t level = 0; level < info.levels; ++level) {
+            offsets.push_back(offset);
+            offset += static_cast<std::size_t>(level_size(info.width, level)) * level_size(info.height, level) * 4;
+        }
+        if (offset > file.size()) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+
+        // Regions index into the texture, so they must lie within the atlas
+        const auto *file_regions = regions();
+        for (std::uint32_t i = 0; i < info.regions; ++i) {
+            const auto &region = file_regions[i];
+            if (region.x < 0 || region.y < 0 || region.w < 0 || region.h < 0 ||
+                static_cast<std::int64_t>(region.x) + region.w > info.width ||
+                static_cast<std::int64_t>(region.y) + region.h > info.height) {
+                throw std::runtime_error(path + " has a region outside of the atlas.");
+            }
+        }
+    }
+
+    bool AtlasFile::is_atlas_file(const std::string &path) {
+        char magic[sizeof(ATLAS_FILE_MAGIC)] = {};
+        std::ifstream stream(path, std::ios::binary);
+        return stream.read(magic, sizeof(magic)) && std::memcmp(magic, ATLAS_FILE_MAGIC, sizeof(magic)) == 0;
+    }
+
+    void AtlasFile::write(const std::string &path, std::uint32_t width, std::uint32_t height,
+                          const std::vector<std::vector<unsigned char>> &levels,
+                          std::vector<AtlasFileRegion> regions) {
+        std::sort(regions.begin(), regions.end(), [](const AtlasFileRegion &a, const AtlasFileRegion &b) {
+            return a.name_hash < b.name_hash;
+        });
+        const auto collision = std::adjacent_find(regions.begin(), regions.end(), [](const auto &a, const auto &b) {
+            return a.name_hash == b.name_hash;
+        });
+        if (collision != regions.end()) {
+            throw std::runtime_error("Names of two atlas regions have the same hash.");
+        }
+
+        AtlasFileHeader header{};
+        std::memcpy(header.magic, ATLAS_FILE_MAGIC, sizeof(ATLAS_FILE_MAGIC));
+        header.version = ATLAS_FILE_VERSION;
+        header.width = width;
+        header.height = height;
+        header.levels = static_cast<std::uint32_t>(levels.size());
+        header.regions = static_cast<std::uint32_t>(regions.size());
+
+        std::ofstream stream(path, std::ios::binary);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(regions.data()),
+                     static_cast<std::streamsize>(regions.size() * sizeof(AtlasFileRegion)));
+        for (const auto &level: levels) {
+            stream.write(reinterpret_cast<const char *>(level.data()), static_cast<std::streamsize>(level.size()));
+        }
+        if (!stream) {
+            throw std::runtime_error("Could not write " + path);
+        }
+    }
+
+}
@@ -0,0 +1,101 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_ATLASFILE_HPP
+#define KEX_ATLASFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.hpp"
+
+namespace kex {
+
+    /**
+     * Layout of a binary atlas file, written in the byte order of little-endian targets:
+     *     -# AtlasFileHeader
+     *     -# AtlasFileHeader::regions entries of AtlasFileRegion, sorted by name hash
+     *     -# AtlasFileHeader::levels mip levels of RGBA8 pixels, starting with the bottom row as OpenGL expects
+     */
+    struct AtlasFileHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t levels;
+        std::uint32_t regions;
+    };
+
+    struct AtlasFileRegion {
+        std::uint64_t name_hash;
+        std::int32_t x, y, w, h;
+    };
+
+    static_assert(sizeof(AtlasFileHeader) == 24 && sizeof(AtlasFileRegion) == 24, "Atlas file layout is packed");
+
+    constexpr char ATLAS_FILE_MAGIC[4] = {'K', 'E', 'X', 'A'};
+    constexpr std::uint32_t ATLAS_FILE_VERSION = 1;
+
+    /**
+     * 64-bit FNV-1a hash of a region name.
+     */
+    std::uint64_t hash_name(const std::string &name);
+
+    /**
+     * Validated view of a binary atlas file.
+     */
+    class AtlasFile {
+    public:
+        explicit AtlasFile(const std::string &path);
+
+        /** Check whether the file at @p path starts with the magic of an atlas file. */
+        static bool is_atlas_file(const std::string &path);
+
+        [[nodiscard]] const AtlasFileHeader &header() const {
+            return *reinterpret_cast<const AtlasFileHeader *>(file.data());
+        }
+
+        [[nodiscard]] const AtlasFileRegion *regions() const {
+            return reinterpret_cast<const AtlasFileRegion *>(file.data() + sizeof(AtlasFileHeader));
+        }
+
+        /** Pixels of the mip level, which is max(1, width >> level) by max(1, height >> level) pixels large. */
+        [[nodiscard]] const unsigned char *level(std::uint32_t level) const { return file.data() + offsets[level]; }
+
+        /** Read the whole file into memory ahead of uploading it. */
+        void prefetch() const { file.prefetch(); }
+
+        static void write(const std::string &path, std::uint32_t width, std::uint32_t height,
+                          const std::vector<std::vector<unsigned char>> &levels,
+                          std::vector<AtlasFileRegion> regions);
+
+    private:
+        MappedFile file;
+        std::vector<std::size_t> offsets;
+    };
+
+    /** Size of a mip level in pixels along one dimension. */
+    constexpr std::uint32_t level_size(std::uint32_t size, std::uint32_t level) {
+        return (size >> level) > 0 ? size >> level : 1;
+    }
+
+}
+
+#endif //KEX_ATLASFILE_HPP
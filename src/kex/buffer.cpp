@@ -17,24 +17,23 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <kex/buffer.hpp>
+#include <kex/state.hpp>
+
+#ifdef __EMSCRIPTEN__
+    #include <vector>
+    #include <stdexcept>
+#endif
 
 #include <glad/gles2.h>
 
 namespace kex {
 
-    template<BufferType T>
-    struct BufferState {
-        static GLuint bound_id;
-    };
-
-    template<BufferType T>
-    GLuint BufferState<T>::bound_id = 0;
-
     template<BufferType T, BufferUsage U>
     class Buffer<T, U>::Impl {
     public:
         explicit Impl(int size) : Impl() {
             bsize = size;
+            this->bind();
             glBufferData(target, size, nullptr, usage);
         }
 
@@ -42,18 +41,24 @@ namespace kex {
             glGenBuffers(1, &id);
             if constexpr (T == BufferType::ARRAY) {
                 target = GL_ARRAY_BUFFER;
+            } else if constexpr (T == BufferType::PIXEL_UNPACK) {
+                target = GL_PIXEL_UNPACK_BUFFER;
+            } else if constexpr (T == BufferType::PIXEL_PACK) {
+                target = GL_PIXEL_PACK_BUFFER;
             }
 
+            // Pixel pack buffers are written by OpenGL and read by the application
             if constexpr (U == BufferUsage::STATIC) {
-                usage = GL_STATIC_DRAW;
+                usage = T == BufferType::PIXEL_PACK ? GL_STATIC_READ : GL_STATIC_DRAW;
             } else if constexpr (U == BufferUsage::STREAM) {
-                usage = GL_STREAM_DRAW;
+                usage = T == BufferType::PIXEL_PACK ? GL_STREAM_READ : GL_STREAM_DRAW;
             }
         }
 
         void replace(const void *data, int size) {
             this->bind();
             glBufferData(target, size, data, usage);
+            bsize = size;
         }
 
         void update(const void *data, int size, int offset) {
@@ -63,28 +68,58 @@ namespace kex {
 
         void orphan(int size) {
             this->bind();
-            glBufferData(target, size == -1 ? bsize : size, nullptr, usage);
+            if (size != -1) {
+                bsize = size;
+            }
+            glBufferData(target, bsize, nullptr, usage);
         }
 
-        void bind() const {
-            if (BufferState<T>::bound_id == id) return;
+        void *map(int size, int offset, bool unsynchronized) {
+            this->bind();
+#ifdef __EMSCRIPTEN__
+            // WebGL 2 does not support buffer mapping, so writes go to client memory and are uploaded on unmap
+            (void) unsynchronized;
+            if constexpr (T == BufferType::PIXEL_PACK) {
+                throw std::runtime_error("Pixel pack buffers cannot be mapped in WebGL 2");
+            }
+            mapped.resize(size);
+            mapped_offset = offset;
+            return mapped.data();
+#else
+            GLbitfield access = T == BufferType::PIXEL_PACK ? GL_MAP_READ_BIT
+                                                             : GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+            if (unsynchronized) {
+                access |= GL_MAP_UNSYNCHRONIZED_BIT;
+            }
+            return glMapBufferRange(target, offset, size, access);
+#endif
+        }
+
+        void unmap() {
+            this->bind();
+#ifdef __EMSCRIPTEN__
+            glBufferSubData(target, mapped_offset, static_cast<GLsizeiptr>(mapped.size()), mapped.data());
+#else
+            glUnmapBuffer(target);
+#endif
+        }
 
-            glBindBuffer(target, id);
-            BufferState<T>::bound_id = id;
+        void bind() const {
+            StateCache::bind_buffer(target, id);
         }
 
         void unbind() const {
-            if (BufferState<T>::bound_id != id) return;
-            glBindBuffer(target, 0);
-            BufferState<T>::bound_id = 0;
+            if (!is_bound()) return;
+            StateCache::bind_buffer(target, 0);
         }
 
         [[nodiscard]] bool is_bound() const {
-            return BufferState<T>::bound_id == id;
+            return StateCache::is_buffer_bound(target, id);
         }
 
         ~Impl() {
             glDeleteBuffers(1, &id);
+            StateCache::forget_buffer(id);
         }
 
     private:
@@ -92,6 +127,10 @@ namespace kex {
         GLenum usage = 0;
         GLuint id = 0;
         int bsize = 0;
+#ifdef __EMSCRIPTEN__
+        std::vector<unsigned char> mapped;
+        int mapped_offset = 0;
+#endif
 
         friend Buffer<T, U>;
     };
@@ -132,6 +171,17 @@ namespace kex {
     template<BufferType T, BufferUsage U>
     void Buffer<T, U>::orphan(int size) { impl->orphan(size); }
 
+    template<BufferType T, BufferUsage U>
+    int Buffer<T, U>::size() const { return impl->bsize; }
+
+    template<BufferType T, BufferUsage U>
+    void *Buffer<T, U>::map(int size, int offset, bool unsynchronized) {
+        return impl->map(size, offset, unsynchronized);
+    }
+
+    template<BufferType T, BufferUsage U>
+    void Buffer<T, U>::unmap() { impl->unmap(); }
+
     template<BufferType T, BufferUsage U>
     Buffer<T, U>::~Buffer() = default;
 
@@ -142,4 +192,10 @@ namespace kex {
     template
     class Buffer<BufferType::ARRAY, BufferUsage::STREAM>;
 
+    template
+    class Buffer<BufferType::PIXEL_UNPACK, BufferUsage::STREAM>;
+
+    template
+    class Buffer<BufferType::PIXEL_PACK, BufferUsage::STREAM>;
+
 }
\ No newline at end of file
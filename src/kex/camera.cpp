@@ -0,0 +1,67 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <kex/camera.hpp>
+#include <kex/kex.hpp>
+#include <cmath>
+
+namespace kex {
+
+    void Camera::set_position(float x, float y) {
+        this->x = x;
+        this->y = y;
+    }
+
+    std::array<float, 3 * 2> Camera::view() const {
+        // NOTE Column-major!
+        // The world is translated by the offset, then zoomed and rotated around the center of the viewport:
+        //     view(p) = center + zoom * rotation * (p - offset - center)
+
+        // Rotating the camera CCW rotates the world CW, which is a positive angle since y-axis points down
+        const auto cos = zoom * std::cos(rotation);
+        const auto sin = zoom * std::sin(rotation);
+        const auto center_x = 0.5f * static_cast<float>(kex::logical_viewport_w);
+        const auto center_y = 0.5f * static_cast<float>(kex::logical_viewport_h);
+        const auto origin_x = x + center_x;
+        const auto origin_y = y + center_y;
+        return {
+                cos, sin,
+                -sin, cos,
+                center_x - (cos * origin_x - sin * origin_y), center_y - (sin * origin_x + cos * origin_y),
+        };
+    }
+
+    RectangleDef Camera::visible_area() const {
+        // Half extents of the viewport mapped back into the world
+        const auto cos = std::abs(std::cos(rotation)) / zoom;
+        const auto sin = std::abs(std::sin(rotation)) / zoom;
+        const auto half_w = 0.5f * static_cast<float>(kex::logical_viewport_w);
+        const auto half_h = 0.5f * static_cast<float>(kex::logical_viewport_h);
+        const auto extent_x = cos * half_w + sin * half_h;
+        const auto extent_y = sin * half_w + cos * half_h;
+        const auto center_x = x + half_w;
+        const auto center_y = y + half_h;
+
+        const auto min_x = static_cast<int>(std::floor(center_x - extent_x));
+        const auto min_y = static_cast<int>(std::floor(center_y - extent_y));
+        const auto max_x = static_cast<int>(std::ceil(center_x + extent_x));
+        const auto max_y = static_cast<int>(std::ceil(center_y + extent_y));
+        return {min_x, min_y, max_x - min_x, max_y - min_y};
+    }
+
+}
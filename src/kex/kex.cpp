@@ -21,6 +21,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <kex/kex.hpp>
 #include <kex/def.hpp>
+#include <kex/state.hpp>
 
 #include <glad/gles2.h>
 
@@ -40,8 +41,9 @@ namespace kex {
         logical_viewport_w = opengl_viewport.w;
         logical_viewport_h = opengl_viewport.h;
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        StateCache::invalidate();
+        StateCache::set_blend(true);
+        StateCache::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         std::cout << "Renderer: " << glGetString(GL_RENDERER) << '\n';
         std::cout << "OpenGL version: " << glGetString(GL_VERSION) << '\n';
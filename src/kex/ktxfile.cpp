@@ -0,0 +1,258 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <glad/gles2.h>
+
+#include "ktxfile.hpp"
+
+namespace kex {
+
+    static constexpr unsigned char KTX1_IDENTIFIER[12] = {
+            0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+    };
+
+    static constexpr unsigned char KTX2_IDENTIFIER[12] = {
+            0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+    };
+
+    /** KTX 1 value of the endianness field when the file matches the byte order of the platform. */
+    static constexpr std::uint32_t KTX1_ENDIANNESS = 0x04030201;
+
+    static constexpr std::uint32_t VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK = 147;
+    static constexpr std::uint32_t VK_FORMAT_EAC_R11G11_SNORM_BLOCK = 156;
+
+    /**
+     * OpenGL formats of ETC2 and EAC in the order of the corresponding Vulkan formats, starting with
+     * VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK.
+     */
+    static constexpr GLenum ETC2_FORMATS[] = {
+            GL_COMPRESSED_RGB8_ETC2,
+            GL_COMPRESSED_SRGB8_ETC2,
+            GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+            GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+            GL_COMPRESSED_RGBA8_ETC2_EAC,
+            GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC,
+            GL_COMPRESSED_R11_EAC,
+            GL_COMPRESSED_SIGNED_R11_EAC,
+            GL_COMPRESSED_RG11_EAC,
+            GL_COMPRESSED_SIGNED_RG11_EAC,
+    };
+
+    /** Size of a compressed block of 4x4 pixels, or 0 if the format is not supported. */
+    static std::size_t block_size(GLenum format) {
+        switch (format) {
+            case GL_COMPRESSED_RGB8_ETC2:
+            case GL_COMPRESSED_SRGB8_ETC2:
+            case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            case GL_COMPRESSED_R11_EAC:
+            case GL_COMPRESSED_SIGNED_R11_EAC:
+                return 8;
+            case GL_COMPRESSED_RGBA8_ETC2_EAC:
+            case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+            case GL_COMPRESSED_RG11_EAC:
+            case GL_COMPRESSED_SIGNED_RG11_EAC:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    static std::uint32_t read_u32(const unsigned char *data, bool swap = false) {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        if (swap) {
+            value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+        }
+        return value;
+    }
+
+    static std::uint64_t read_u64(const unsigned char *data) {
+        std::uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    /**
+     * Find the value of the orientation key within key/value data, where each entry consists of its size, a
+     * null-terminated key and a value, padded to 4 bytes.
+     */
+    static std::string find_orientation(const unsigned char *data, std::size_t size, bool swap) {
+        static constexpr char KEY[] = "KTXorientation";
+        std::size_t offset = 0;
+        while (offset + 4 <= size) {
+            const auto entry_size = read_u32(data + offset, swap);
+            const auto *entry = reinterpret_cast<const char *>(data + offset + 4);
+            if (entry_size > size - offset - 4) break;
+            if (entry_size > sizeof(KEY) && std::memcmp(entry, KEY, sizeof(KEY)) == 0) {
+                const auto *value = entry + sizeof(KEY);
+                return {value, strnlen(value, entry_size - sizeof(KEY))};
+            }
+            offset += 4 + (static_cast<std::size_t>(entry_size) + 3) / 4 * 4;
+        }
+        return {};
+    }
+
+    KtxFile::KtxFile(const std::string &path) : file(path) {
+        if (file.size() >= sizeof(KTX1_IDENTIFIER) &&
+            std::memcmp(file.data(), KTX1_IDENTIFIER, sizeof(KTX1_IDENTIFIER)) == 0) {
+            parse_ktx1(path);
+        } else if (file.size() >= sizeof(KTX2_IDENTIFIER) &&
+                   std::memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+            parse_ktx2(path);
+        } else {
+            throw std::runtime_error(path + " is not a KTX file.");
+        }
+    }
+
+    bool KtxFile::is_ktx_file(const std::string &path) {
+        unsigned char identifier[sizeof(KTX1_IDENTIFIER)] = {};
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream.read(reinterpret_cast<char *>(identifier), sizeof(identifier))) return false;
+        return std::memcmp(identifier, KTX1_IDENTIFIER, sizeof(identifier)) == 0 ||
+               std::memcmp(identifier, KTX2_IDENTIFIER, sizeof(identifier)) == 0;
+    }
+
+    void KtxFile::parse_ktx1(const std::string &path) {
+        // Identifier followed by 13 fields of 32 bits
+        static constexpr std::size_t HEADER_SIZE = 12 + 13 * 4;
+        if (file.size() < HEADER_SIZE) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+
+        const auto *data = file.data();
+        const auto endianness = read_u32(data + 12);
+        if (endianness != KTX1_ENDIANNESS && read_u32(data + 12, true) != KTX1_ENDIANNESS) {
+            throw std::runtime_error(path + " has an invalid endianness.");
+        }
+        const auto swap = endianness != KTX1_ENDIANNESS;
+        const auto field = [data, swap](int index) { return read_u32(data + 16 + 4 * index, swap); };
+
+        const auto gl_type = field(0);
+        format = field(3);
+        const auto width = field(5);
+        const auto height = field(6);
+        const auto depth = field(7);
+        const auto array_elements = field(8);
+        const auto faces = field(9);
+        const auto level_count = std::max<std::uint32_t>(field(10), 1);
+        const auto key_value_size = field(11);
+        if (gl_type != 0 || block_size(format) == 0) {
+            throw std::runtime_error(path + " is not compressed with ETC2 or EAC.");
+        }
+        if (depth > 1 || array_elements != 0 || faces != 1) {
+            throw std::runtime_error(path + " is not a 2D texture.");
+        }
+        if (key_value_size > file.size() - HEADER_SIZE) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+
+        const auto orientation = find_orientation(data + HEADER_SIZE, key_value_size, swap);
+        top_down = orientation.find("T=u") == std::string::npos;
+
+        // Each level is preceded by its size and padded to 4 bytes
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        auto offset = HEADER_SIZE + key_value_size;
+        for (std::uint32_t level = 0; level < level_count; ++level) {
+            if (offset + 4 > file.size()) {
+                throw std::runtime_error(path + " is truncated.");
+            }
+            const std::size_t size = read_u32(data + offset, swap);
+            ranges.emplace_back(offset + 4, size);
+            offset += 4 + (size + 3) / 4 * 4;
+        }
+        add_levels(path, width, height, level_count, ranges);
+    }
+
+    void KtxFile::parse_ktx2(const std::string &path) {
+        // Identifier, 9 fields of 32 bits, 4 index fields of 32 bits and 2 index fields of 64 bits
+        static constexpr std::size_t HEADER_SIZE = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+        static constexpr std::size_t LEVEL_INDEX_ENTRY_SIZE = 3 * 8;
+        if (file.size() < HEADER_SIZE) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+
+        const auto *data = file.data();
+        const auto field = [data](int index) { return read_u32(data + 12 + 4 * index); };
+        const auto vk_format = field(0);
+        const auto width = field(2);
+        const auto height = field(3);
+        const auto depth = field(4);
+        const auto layers = field(5);
+        const auto faces = field(6);
+        const auto level_count = std::max<std::uint32_t>(field(7), 1);
+        const auto supercompression = field(8);
+        const auto key_value_offset = field(11);
+        const auto key_value_size = field(12);
+        if (vk_format < VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK || vk_format > VK_FORMAT_EAC_R11G11_SNORM_BLOCK) {
+            throw std::runtime_error(path + " is not compressed with ETC2 or EAC.");
+        }
+        if (supercompression != 0) {
+            throw std::runtime_error(path + " is supercompressed.");
+        }
+        if (depth > 1 || layers > 1 || faces != 1) {
+            throw std::runtime_error(path + " is not a 2D texture.");
+        }
+        if (HEADER_SIZE + level_count * LEVEL_INDEX_ENTRY_SIZE > file.size() ||
+            key_value_offset > file.size() || key_value_size > file.size() - key_value_offset) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+        format = ETC2_FORMATS[vk_format - VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK];
+
+        const auto orientation = find_orientation(data + key_value_offset, key_value_size, false);
+        top_down = orientation.size() < 2 || orientation[1] != 'u';
+
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        for (std::uint32_t level = 0; level < level_count; ++level) {
+            const auto *entry = data + HEADER_SIZE + level * LEVEL_INDEX_ENTRY_SIZE;
+            ranges.emplace_back(static_cast<std::size_t>(read_u64(entry)),
+                                static_cast<std::size_t>(read_u64(entry + 8)));
+        }
+        add_levels(path, width, height, level_count, ranges);
+    }
+
+    void KtxFile::add_levels(const std::string &path, std::uint32_t width, std::uint32_t height, std::uint32_t count,
+                             const std::vector<std::pair<std::size_t, std::size_t>> &ranges) {
+        if (width == 0 || height == 0 || count > 32) {
+            throw std::runtime_error(path + " has invalid dimensions.");
+        }
+
+        for (std::uint32_t level = 0; level < count; ++level) {
+            const auto level_width = std::max<std::uint32_t>(width >> level, 1);
+            const auto level_height = std::max<std::uint32_t>(height >> level, 1);
+            const auto expected = static_cast<std::size_t>((level_width + 3) / 4) * ((level_height + 3) / 4) *
+                                  block_size(format);
+            const auto [offset, size] = ranges[level];
+            if (size != expected) {
+                throw std::runtime_error(path + " has a mip level of an unexpected size.");
+            }
+            if (offset > file.size() || size > file.size() - offset) {
+                throw std::runtime_error(path + " is truncated.");
+            }
+            levels.push_back({static_cast<int>(level_width), static_cast<int>(level_height), file.data() + offset,
+                              size});
+        }
+    }
+
+}
@@ -0,0 +1,81 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_KTXFILE_HPP
+#define KEX_KTXFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.hpp"
+
+namespace kex {
+
+    /**
+     * Validated view of a KTX 1 or KTX 2 file holding a 2D texture compressed with ETC2 or EAC.
+     *
+     * Only the formats required by OpenGL ES 3.0 are accepted, and KTX 2 files must not be supercompressed.
+     */
+    class KtxFile {
+    public:
+        struct Level {
+            int width, height;
+            const unsigned char *data;
+            std::size_t size;
+        };
+
+        explicit KtxFile(const std::string &path);
+
+        /** Check whether the file at @p path starts with the identifier of a KTX 1 or KTX 2 file. */
+        static bool is_ktx_file(const std::string &path);
+
+        /** OpenGL internal format of the compressed texture. */
+        [[nodiscard]] unsigned int internal_format() const { return format; }
+
+        [[nodiscard]] int width() const { return levels.front().width; }
+
+        [[nodiscard]] int height() const { return levels.front().height; }
+
+        /** Mip levels, starting with the base level. */
+        [[nodiscard]] const std::vector<Level> &mip_levels() const { return levels; }
+
+        /** Whether the first row of the image is the top one, which is the default orientation of KTX files. */
+        [[nodiscard]] bool is_top_down() const { return top_down; }
+
+        /** Read the whole file into memory ahead of uploading it. */
+        void prefetch() const { file.prefetch(); }
+
+    private:
+        MappedFile file;
+        unsigned int format = 0;
+        std::vector<Level> levels;
+        bool top_down = true;
+
+        void parse_ktx1(const std::string &path);
+
+        void parse_ktx2(const std::string &path);
+
+        void add_levels(const std::string &path, std::uint32_t width, std::uint32_t height, std::uint32_t count,
+                        const std::vector<std::pair<std::size_t, std::size_t>> &ranges);
+    };
+
+}
+
+#endif //KEX_KTXFILE_HPP
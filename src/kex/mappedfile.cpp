@@ -0,0 +1,80 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define KEX_HAS_MMAP
+#endif
+
+#include "mappedfile.hpp"
+
+namespace kex {
+
+    MappedFile::MappedFile(const std::string &path) {
+#ifdef KEX_HAS_MMAP
+        const auto fd = open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat status{};
+            if (fstat(fd, &status) == 0 && status.st_size > 0) {
+                auto *address = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (address != MAP_FAILED) {
+                    mapped = static_cast<const unsigned char *>(address);
+                    length = static_cast<std::size_t>(status.st_size);
+                }
+            }
+            close(fd);
+            if (mapped) return;
+        }
+#endif
+
+        // Fall back to reading the whole file
+        std::ifstream stream(path, std::ios::binary | std::ios::ate);
+        if (!stream) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        length = static_cast<std::size_t>(stream.tellg());
+        buffer.resize(length);
+        stream.seekg(0);
+        if (!stream.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(length))) {
+            throw std::runtime_error("Could not read " + path);
+        }
+    }
+
+    void MappedFile::prefetch() const {
+        if (!mapped) return;
+        constexpr std::size_t PAGE = 4096;
+        unsigned char sum = 0;
+        for (std::size_t offset = 0; offset < length; offset += PAGE) {
+            sum ^= static_cast<const volatile unsigned char *>(mapped)[offset];
+        }
+        static_cast<void>(sum);
+    }
+
+    MappedFile::~MappedFile() {
+#ifdef KEX_HAS_MMAP
+        if (mapped) munmap(const_cast<unsigned char *>(mapped), length);
+#endif
+    }
+
+}
@@ -0,0 +1,56 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_MAPPEDFILE_HPP
+#define KEX_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace kex {
+
+    /**
+     * Read-only view of a whole file, memory-mapped where the platform supports it and read otherwise.
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &path);
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        [[nodiscard]] const unsigned char *data() const { return mapped ? mapped : buffer.data(); }
+
+        [[nodiscard]] std::size_t size() const { return length; }
+
+        /** Read every page of the file, so that reading it later on another thread does not wait for the disk. */
+        void prefetch() const;
+
+        ~MappedFile();
+
+    private:
+        const unsigned char *mapped = nullptr;
+        std::size_t length = 0;
+        std::vector<unsigned char> buffer;
+    };
+
+}
+
+#endif //KEX_MAPPEDFILE_HPP
@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <kex/program.hpp>
+#include <kex/state.hpp>
 
 #include <glad/gles2.h>
 
@@ -36,11 +37,12 @@ namespace kex {
         }
 
         void use() const {
-            glUseProgram(id);
+            StateCache::use_program(id);
         }
 
         ~Impl() {
             glDeleteProgram(id);
+            StateCache::forget_program(id);
         }
 
     private:
@@ -0,0 +1,125 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <kex/ringbuffer.hpp>
+
+#include <vector>
+
+#include <glad/gles2.h>
+
+namespace kex {
+
+    /** Alignment of mapped ranges in bytes. */
+    static constexpr int RANGE_ALIGNMENT = 16;
+
+    template<BufferType T>
+    class RingBuffer<T>::Impl {
+    public:
+        Impl(int region_size, int regions) :
+                buffer(region_size * regions),
+                region_size(region_size),
+                fences(regions, nullptr) {}
+
+        void *map(int size, int &offset) {
+            if (region_offset + size > region_size) {
+                next_region(size);
+            }
+
+            offset = region * region_size + region_offset;
+            region_offset += (size + RANGE_ALIGNMENT - 1) / RANGE_ALIGNMENT * RANGE_ALIGNMENT;
+            return buffer.map(size, offset, true);
+        }
+
+        void unmap() {
+            buffer.unmap();
+        }
+
+        ~Impl() {
+            for (auto fence: fences) {
+                if (fence != nullptr) glDeleteSync(fence);
+            }
+        }
+
+    private:
+        Buffer<T, BufferUsage::STREAM> buffer;
+        int region_size;
+        int region = 0;
+        int region_offset = 0;
+        std::vector<GLsync> fences;
+
+        void next_region(int size) {
+            if (size > region_size) {
+                // Orphaning hands the old storage over to the driver, so no region needs to be waited for
+                for (auto &fence: fences) {
+                    if (fence != nullptr) glDeleteSync(fence);
+                    fence = nullptr;
+                }
+                while (region_size < size) region_size *= 2;
+                buffer.orphan(region_size * static_cast<int>(fences.size()));
+                region = 0;
+                region_offset = 0;
+                return;
+            }
+
+#ifndef __EMSCRIPTEN__
+            // Commands reading from the current region have all been issued by now
+            // (WebGL 2 uploads through glBufferSubData, which is already synchronized)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+            region = (region + 1) % static_cast<int>(fences.size());
+            region_offset = 0;
+
+            auto &fence = fences[region];
+            if (fence == nullptr) return;
+            GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            while (glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED) {
+                flags = 0;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        friend RingBuffer<T>;
+    };
+
+    template<BufferType T>
+    RingBuffer<T>::RingBuffer(int region_size, int regions) : impl(std::make_unique<Impl>(region_size, regions)) {}
+
+    template<BufferType T>
+    RingBuffer<T>::RingBuffer(RingBuffer<T> &&ring_buffer) noexcept = default;
+
+    template<BufferType T>
+    const Buffer<T, BufferUsage::STREAM> &RingBuffer<T>::buffer() const { return impl->buffer; }
+
+    template<BufferType T>
+    void *RingBuffer<T>::map(int size, int &offset) { return impl->map(size, offset); }
+
+    template<BufferType T>
+    void RingBuffer<T>::unmap() { impl->unmap(); }
+
+    template<BufferType T>
+    RingBuffer<T>::~RingBuffer() = default;
+
+    // Specializations
+    template
+    class RingBuffer<BufferType::ARRAY>;
+
+    template
+    class RingBuffer<BufferType::PIXEL_UNPACK>;
+
+}
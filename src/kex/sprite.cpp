@@ -17,106 +17,89 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <kex/sprite.hpp>
-#include <cmath>
+#include <type_traits>
 
-namespace kex {
-
-    class Sprite::Impl {
-    public:
-        explicit Impl(const Texture &texture) :
-                Impl(texture, {0, 0, texture.width(), texture.height()}) {}
-
-        explicit Impl(const Texture &texture, const RectangleDef &rectangle) :
-                texture(texture),
-                texture_region(rectangle),
-                u_min(compute_u_min(rectangle, texture)),
-                u_max(compute_u_max(rectangle, texture)),
-                v_min(compute_v_min(rectangle, texture)),
-                v_max(compute_v_max(rectangle, texture)),
-                w(rectangle.w),
-                h(rectangle.h) {}
+#include "textureregistry.hpp"
+#include "spritetransform.hpp"
 
+namespace kex {
 
-        [[nodiscard]] std::array<float, 3 * 3>
-        get_transform(float x, float y, float rotation, float shear_x, float shear_y, float scale_x,
-                      float scale_y) const {
-            // NOTE Column-major!
-            // Vertex is a column vector multiplied by the transform from the left
+    static_assert(std::is_trivially_copyable_v<Sprite>, "Sprites are meant to be copied as plain values");
+    static_assert(sizeof(Sprite) == 11 * sizeof(float) + sizeof(TextureHandle) + sizeof(std::uint16_t),
+                  "Sprites are meant to be compact");
 
-            // 1. Rotation
-            // {
-            //     cos, sin, 0,
-            //     -sin, cos 0,
-            //     0, 0, 1
-            // };
+    static inline const TextureRegion &sprite_region(TextureHandle handle, std::uint16_t region) {
+        return TextureRegistry::get(handle).region(region);
+    }
 
-            // 2. Translation
-            // {
-            //     w, shear_y, 0,
-            //     shear_x, h, 0,
-            //     x, y, 1
-            // };
+    Sprite::Sprite(const kex::Texture &texture) :
+            Sprite(texture, {0, 0, texture.width(), texture.height()}) {}
 
-            // Negative to keep CCW rotation direction since y-axis points down in the pixel coordinate system
-            const auto cos = std::cos(-rotation);
-            const auto sin = std::sin(-rotation);
-            const auto w_scaled = w * scale_x;
-            const auto h_scaled = h * scale_y;
-            return {
-                    w_scaled * cos + shear_x * sin, shear_y * cos + h_scaled * sin, 0,
-                    -w_scaled * sin + shear_x * cos, -shear_y * sin + h_scaled * cos, 0,
-                    x, y, 1,
-            };
-        }
+    Sprite::Sprite(const Texture &texture, const RectangleDef &region) :
+            handle(texture.handle()),
+            region(TextureRegistry::region(texture.handle(), region)) {}
 
-    private:
-        const Texture &texture;
-        const RectangleDef texture_region;
-        const float u_min, u_max, v_min, v_max;
-        const float w, h;
+    Sprite::Sprite(const TextureArray &texture_array, int layer) :
+            Sprite(texture_array, layer, {0, 0, texture_array.width(), texture_array.height()}) {}
 
-        static inline float compute_u_min(const RectangleDef &region, const Texture &texture) {
-            return static_cast<float>(region.x) / texture.width();
-        }
+    Sprite::Sprite(const TextureArray &texture_array, int layer, const RectangleDef &region) :
+            handle(texture_array.handle()),
+            region(TextureRegistry::region(texture_array.handle(), region, layer)) {}
 
-        static inline float compute_u_max(const RectangleDef &region, const Texture &texture) {
-            return static_cast<float>(region.x + region.w) / texture.width();
-        }
+    const Texture &Sprite::texture() const { return *TextureRegistry::get(handle).texture; }
 
-        static inline float compute_v_min(const RectangleDef &region, const Texture &texture) {
-            return 1 - static_cast<float>(region.y + region.h) / texture.height();
-        }
+    const TextureArray &Sprite::texture_array() const { return *TextureRegistry::get(handle).texture_array; }
 
-        static inline float compute_v_max(const RectangleDef &region, const Texture &texture) {
-            return 1 - static_cast<float>(region.y) / texture.height();
-        }
+    bool Sprite::is_layered() const { return TextureRegistry::get(handle).texture_array != nullptr; }
 
-        friend Sprite;
-    };
+    int Sprite::texture_layer() const { return sprite_region(handle, region).layer; }
 
-    Sprite::Sprite(const kex::Texture &texture) : impl(std::make_unique<Impl>(texture)) {}
+    unsigned int Sprite::texture_id() const { return TextureRegistry::get(handle).id; }
 
-    Sprite::Sprite(const Texture &texture, const RectangleDef &region) : impl(
-            std::make_unique<Impl>(texture, region)) {}
+    const RectangleDef &Sprite::texture_region() const { return sprite_region(handle, region).rectangle; }
 
-    const Texture &Sprite::texture() const { return impl->texture; }
+    float Sprite::u_min() const { return sprite_region(handle, region).u_min; }
 
-    const RectangleDef &Sprite::texture_region() const { return impl->texture_region; }
+    float Sprite::u_max() const { return sprite_region(handle, region).u_max; }
 
-    float Sprite::u_min() const { return impl->u_min; }
+    float Sprite::v_min() const { return sprite_region(handle, region).v_min; }
 
-    float Sprite::u_max() const { return impl->u_max; }
+    float Sprite::v_max() const { return sprite_region(handle, region).v_max; }
 
-    float Sprite::v_min() const { return impl->v_min; }
+    TextureHandle Sprite::texture_handle() const { return handle; }
 
-    float Sprite::v_max() const { return impl->v_max; }
+    std::uint16_t Sprite::region_index() const { return region; }
 
-    int Sprite::width() const { return impl->w; }
+    int Sprite::width() const { return sprite_region(handle, region).rectangle.w; }
 
-    int Sprite::height() const { return impl->h; }
+    int Sprite::height() const { return sprite_region(handle, region).rectangle.h; }
 
     std::array<float, 3 * 3> Sprite::transform() const {
-        return impl->get_transform(x, y, rotation, shear_x, shear_y, scale_x, scale_y);
+        // NOTE Column-major!
+        // Vertex is a column vector multiplied by the transform from the left
+
+        // 1. Rotation
+        // {
+        //     cos, sin, 0,
+        //     -sin, cos 0,
+        //     0, 0, 1
+        // };
+
+        // 2. Translation
+        // {
+        //     w, shear_y, 0,
+        //     shear_x, h, 0,
+        //     x, y, 1
+        // };
+
+        const auto &rectangle = sprite_region(handle, region).rectangle;
+        const auto linear = sprite_linear(static_cast<float>(rectangle.w) * scale_x,
+                                          static_cast<float>(rectangle.h) * scale_y, rotation, shear_x, shear_y);
+        return {
+                linear[0], linear[1], 0,
+                linear[2], linear[3], 0,
+                x, y, 1,
+        };
     }
 
     void Sprite::set_tint(float r, float g, float b, float a) {
@@ -141,6 +124,4 @@ namespace kex {
         this->shear_y = shear_y;
     }
 
-    Sprite::~Sprite() = default;
-
 }
@@ -17,57 +17,163 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <vector>
-#include <unordered_map>
+#include <array>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include <kex/spritebatch.hpp>
 #include <kex/sprite.hpp>
 #include <kex/shader.hpp>
 #include "kex/kex.hpp"
 #include <kex/program.hpp>
 #include <kex/vertexarray.hpp>
+#include <kex/ringbuffer.hpp>
+#include <kex/state.hpp>
+#include <kex/spritepool.hpp>
+
+#include "spriteinstance.hpp"
+#include "spritesort.hpp"
+#include "spritetransform.hpp"
+#include "textureregistry.hpp"
 
 #include <glad/gles2.h>
 
 namespace kex {
 
-    static constexpr auto vertex_shader_source = R"(
+    static constexpr auto vertex_shader_template = R"(
         #version 300 es
 
         layout (location = 0) in highp vec2 base_position_in;
-        layout (location = 1) in highp vec2 tex_coords_in;
-        layout (location = 2) in highp mat3 transform_in;
-        // layout (location = 3)
-        // layout (location = 4)
-        layout (location = 5) in highp vec4 tint_in;
+        layout (location = 1) in highp vec4 tex_region_in;
+        $TRANSFORM_INPUTS
+        layout (location = 5) in lowp vec4 tint_in;
+        layout (location = 6) in highp float tex_layer_in;
+        layout (location = 7) in highp float tex_slot_in;
 
         uniform highp int width;
         uniform highp int height;
+        uniform highp mat3x2 view;
 
         out highp vec2 tex_coords;
-        out highp vec4 tint;
+        out lowp vec4 tint;
+        flat out highp float tex_layer;
+        flat out highp float tex_slot;
 
         void main() {
-            highp vec3 position = transform_in * vec3(base_position_in, 1) / vec3(width / 2, -height / 2, 1) - vec3(1, -1, 0);
-            gl_Position = vec4(position.xy, 0, position.z);
-            tex_coords = tex_coords_in;
+            $TRANSFORM
+            highp vec2 world_position = transform * vec3(base_position_in, 1);
+            highp vec2 position = view * vec3(world_position, 1) / vec2(width / 2, -height / 2) - vec2(1, -1);
+            gl_Position = vec4(position, 0, 1);
+            highp vec2 region_position = vec2(base_position_in.x + 0.5, 0.5 - base_position_in.y);
+            tex_coords = mix(tex_region_in.xy, tex_region_in.zw, region_position);
             tint = tint_in;
+            tex_layer = tex_layer_in;
+            tex_slot = tex_slot_in;
         }
     )";
 
-    static constexpr auto fragment_shader_source = R"(
+    static constexpr auto cpu_transform_inputs = R"(
+        layout (location = 2) in highp mat3x2 transform_in;
+        // layout (location = 3)
+        // layout (location = 4)
+    )";
+
+    static constexpr auto cpu_transform = R"(
+        highp mat3x2 transform = transform_in;
+    )";
+
+    static constexpr auto gpu_transform_inputs = R"(
+        layout (location = 2) in highp vec4 placement_in;
+        layout (location = 3) in highp float rotation_in;
+        layout (location = 4) in highp vec2 shear_in;
+    )";
+
+    // Same matrix as Sprite::transform()
+    static constexpr auto gpu_transform = R"(
+        highp float cos_rotation = cos(-rotation_in);
+        highp float sin_rotation = sin(-rotation_in);
+        highp mat3x2 transform = mat3x2(
+            placement_in.z * cos_rotation + shear_in.x * sin_rotation,
+            shear_in.y * cos_rotation + placement_in.w * sin_rotation,
+            -placement_in.z * sin_rotation + shear_in.x * cos_rotation,
+            -shear_in.y * sin_rotation + placement_in.w * cos_rotation,
+            placement_in.xy
+        );
+    )";
+
+    static void replace_placeholder(std::string &source, const std::string &placeholder, const std::string &value) {
+        for (auto position = source.find(placeholder);
+             position != std::string::npos;
+             position = source.find(placeholder, position + value.size())) {
+            source.replace(position, placeholder.size(), value);
+        }
+    }
+
+    /**
+     * Generate the source of the vertex shader for a transform mode.
+     */
+    static std::string vertex_shader_source(SpriteTransform transform) {
+        const bool is_gpu = transform == SpriteTransform::GPU;
+        std::string source = vertex_shader_template;
+        replace_placeholder(source, "$TRANSFORM_INPUTS", is_gpu ? gpu_transform_inputs : cpu_transform_inputs);
+        replace_placeholder(source, "$TRANSFORM", is_gpu ? gpu_transform : cpu_transform);
+        return source;
+    }
+
+    static constexpr auto fragment_shader_template = R"(
         #version 300 es
 
-        uniform sampler2D tex;
+        uniform mediump $SAMPLER tex[$SLOTS];
 
         in highp vec2 tex_coords;
-        in highp vec4 tint;
+        in lowp vec4 tint;
+        flat in highp float tex_layer;
+        flat in highp float tex_slot;
 
         out highp vec4 color_out;
 
         void main() {
-            color_out = texture2D(tex, tex_coords) * tint;
+            highp $COORDS_TYPE coords = $COORDS;
+            highp vec2 coords_dx = dFdx(tex_coords);
+            highp vec2 coords_dy = dFdy(tex_coords);
+            int slot = int(tex_slot);
+            lowp vec4 color;
+            $BRANCHES
+            color_out = color * tint;
         }
     )";
 
+    /**
+     * Generate the source of a fragment shader sampling one of several bound textures, selected per instance.
+     *
+     * Sampler arrays can only be indexed with constant expressions in GLSL ES 3.00, so the texture is selected by
+     * branching on the slot. Gradients are computed before branching because implicit derivatives are undefined in
+     * non-uniform control flow.
+     */
+    static std::string fragment_shader_source(SpriteProgram program, int texture_slots) {
+        const bool is_array = program == SpriteProgram::TEXTURE_ARRAY;
+
+        std::string branches;
+        for (int slot = 0; slot < texture_slots; ++slot) {
+            const auto index = std::to_string(slot);
+            if (slot > 0) branches += " else ";
+            if (slot < texture_slots - 1) branches += "if (slot == " + index + ") ";
+            branches += "color = textureGrad(tex[" + index + "], coords, coords_dx, coords_dy);";
+        }
+
+        std::string source = fragment_shader_template;
+        replace_placeholder(source, "$SAMPLER", is_array ? "sampler2DArray" : "sampler2D");
+        replace_placeholder(source, "$SLOTS", std::to_string(texture_slots));
+        replace_placeholder(source, "$COORDS_TYPE", is_array ? "vec3" : "vec2");
+        replace_placeholder(source, "$COORDS", is_array ? "vec3(tex_coords, tex_layer)" : "tex_coords");
+        replace_placeholder(source, "$BRANCHES", branches);
+        return source;
+    }
+
     static constexpr float normalized_positions_data[] = {
             -0.5f, 0.5f,
             0.5f, 0.5f,
@@ -75,128 +181,553 @@ namespace kex {
             0.5f, -0.5f,
     };
 
+    /**
+     * Maximum number of textures bound for a single draw call.
+     *
+     * Limited further by GL_MAX_TEXTURE_IMAGE_UNITS, which is at least 16 in OpenGL ES 3.0.
+     */
+    static constexpr int MAX_TEXTURE_SLOTS = 16;
+
+    struct SpriteProgramCtx {
+        Program program;
+        int width_location;
+        int height_location;
+        int view_location;
+
+        /** Last view set on the program, NaN until the first one. */
+        mutable std::array<float, 3 * 2> view;
+
+        SpriteProgramCtx(const VertexShader &vertex_shader, const FragmentShader &fragment_shader, int texture_slots) :
+                program(vertex_shader, fragment_shader),
+                width_location(program.get_uniform_location("width")),
+                height_location(program.get_uniform_location("height")),
+                view_location(program.get_uniform_location("view")) {
+            view.fill(std::numeric_limits<float>::quiet_NaN());
+
+            // Sampler i reads from texture unit i
+            std::array<int, MAX_TEXTURE_SLOTS> units{};
+            for (int slot = 0; slot < texture_slots; ++slot) {
+                units[slot] = slot;
+            }
+            program.use();
+            glUniform1iv(program.get_uniform_location("tex"), texture_slots, units.data());
+        }
+    };
+
+    /** Initial size of each instance ring buffer region in bytes. */
+    static constexpr int INSTANCE_REGION_SIZE = 1024 * sizeof(SpriteInstance);
+
+    /**
+     * Specify the vertex attributes of a sprite quad and the instances starting at the base offset.
+     */
+    template<BufferUsage Usg>
+    static void add_sprite_attributes(VertexArray &vao, const StaticArrayBuffer &positions,
+                                      const ArrayBuffer<Usg> &instances, SpriteTransform transform,
+                                      int base_offset = 0) {
+        constexpr int stride = sizeof(SpriteInstance);
+        vao.add_attribute<VertexAttr::VEC2>(positions);
+        vao.add_attribute<VertexAttr::VEC4_USHORT, 1, true>(
+                instances, stride, base_offset + offsetof(SpriteInstance, tex_region));
+        if (transform == SpriteTransform::GPU) {
+            const int parameters = base_offset + offsetof(SpriteInstance, parameters);
+            vao.add_attribute<VertexAttr::VEC4, 1>(instances, stride, parameters);
+            vao.add_attribute<VertexAttr::FLOAT, 1>(
+                    instances, stride, parameters + offsetof(decltype(SpriteInstance::parameters), rotation));
+            vao.add_attribute<VertexAttr::VEC2_HALF, 1>(
+                    instances, stride, parameters + offsetof(decltype(SpriteInstance::parameters), shear));
+        } else {
+            vao.add_attribute<VertexAttr::MAT3X2, 1>(
+                    instances, stride, base_offset + offsetof(SpriteInstance, transform));
+        }
+        vao.add_attribute<VertexAttr::VEC4_UBYTE, 1, true>(
+                instances, stride, base_offset + offsetof(SpriteInstance, tint));
+        vao.add_attribute<VertexAttr::FLOAT_USHORT, 1>(
+                instances, stride, base_offset + offsetof(SpriteInstance, tex_layer));
+        vao.add_attribute<VertexAttr::FLOAT_USHORT, 1>(
+                instances, stride, base_offset + offsetof(SpriteInstance, tex_slot));
+    }
+
+    static StaticArrayBuffer make_quad_buffer() {
+        StaticArrayBuffer positions(4 * 2 * sizeof(float));
+        positions.replace(normalized_positions_data, 4 * 2 * sizeof(float));
+        return positions;
+    }
+
     struct SpriteBatchCtx {
         VertexArray vao;
-        StaticArrayBuffer v_positions{4 * 2 * sizeof(float)};
-        StreamArrayBuffer v_tex_coords;
-        StreamArrayBuffer s_transforms;
-        StreamArrayBuffer s_tints;
+        StaticArrayBuffer v_positions = make_quad_buffer();
+        ArrayRingBuffer s_instances{INSTANCE_REGION_SIZE};
+
+        explicit SpriteBatchCtx(SpriteTransform transform) {
+            add_sprite_attributes(vao, v_positions, s_instances.buffer(), transform);
+        }
     };
 
-    struct SpriteBatchGroupData {
-        unsigned int texture_id = 0;
-        std::vector<float> v_tex_coords;
-        std::vector<float> s_transforms;
-        std::vector<float> s_tints;
-        int instance_count = 0;
+    /**
+     * Sprites recorded for drawing: their instance data and sort entries.
+     *
+     * Recording does not touch OpenGL and is therefore safe on any thread.
+     */
+    struct SpriteRecording {
+        SpriteTransform transform;
+        std::vector<SpriteInstance> instances;
+        std::vector<SpriteSortEntry> entries;
+        SpriteTransformCache transforms;
+
+        explicit SpriteRecording(SpriteTransform transform) : transform(transform) {}
+
+        void clear() {
+            // Only the sizes are reset so that the storage can be reused
+            instances.clear();
+            entries.clear();
+            transforms.rewind();
+        }
+
+        /**
+         * Record a sprite.
+         *
+         * @param matrix Transform of the sprite if it is already computed, only used in the CPU mode
+         */
+        void add(const Sprite &sprite, int layer, const std::array<float, 3 * 2> *matrix = nullptr) {
+            // Resolve the texture and the region once instead of through the accessors of the sprite
+            const auto &record = TextureRegistry::get(sprite.texture_handle());
+            const auto &region = record.region(sprite.region_index());
+            const auto program = record.texture_array ? SpriteProgram::TEXTURE_ARRAY : SpriteProgram::TEXTURE;
+            entries.push_back({
+                    make_sort_key(layer, program, sprite.texture_handle()),
+                    static_cast<std::uint32_t>(instances.size())
+            });
+
+            auto &instance = instances.emplace_back();
+            if (transform == SpriteTransform::GPU) {
+                auto &parameters = instance.parameters;
+                parameters.x = sprite.x;
+                parameters.y = sprite.y;
+                parameters.w_scaled = static_cast<float>(region.rectangle.w) * sprite.scale_x;
+                parameters.h_scaled = static_cast<float>(region.rectangle.h) * sprite.scale_y;
+                parameters.rotation = sprite.rotation;
+                parameters.shear[0] = pack_half(sprite.shear_x);
+                parameters.shear[1] = pack_half(sprite.shear_y);
+            } else if (matrix != nullptr) {
+                std::copy(matrix->begin(), matrix->end(), instance.transform);
+            } else {
+                const auto computed = transforms.transform(sprite, region.rectangle);
+                std::copy(computed.begin(), computed.end(), instance.transform);
+            }
+            std::copy(std::begin(region.packed), std::end(region.packed), instance.tex_region);
+            instance.tint[0] = pack_unorm8(sprite.tint_r);
+            instance.tint[1] = pack_unorm8(sprite.tint_g);
+            instance.tint[2] = pack_unorm8(sprite.tint_b);
+            instance.tint[3] = pack_unorm8(sprite.tint_a);
+            instance.tex_layer = static_cast<std::uint16_t>(region.layer);
+        }
+
+        void add(const SpritePool &pool, int layer) {
+            const auto count = pool.size();
+            if (count == 0) return;
+
+            // All sprites of a pool share the sort key
+            const auto key = make_sort_key(layer, SpriteProgram::TEXTURE, pool.texture().handle());
+            const auto first = instances.size();
+            for (std::size_t i = 0; i < count; ++i) {
+                entries.push_back({key, static_cast<std::uint32_t>(first + i)});
+            }
+            instances.resize(first + count);
+            pool.write_instances(instances.data() + first, transform);
+        }
+
+        void append(const SpriteRecording &recording) {
+            const auto index_offset = static_cast<std::uint32_t>(instances.size());
+            instances.insert(instances.end(), recording.instances.begin(), recording.instances.end());
+            for (const auto &entry: recording.entries) {
+                entries.push_back({entry.key, entry.index + index_offset});
+            }
+        }
     };
 
-    class SpriteBatch::Impl {
+    class SpriteRecorder::Impl {
     public:
-        Impl() {
-            ctx_index = last_used_ctx_index + 1;
-            if (last_used_ctx_index == ctxs.size() - 1) {
-                auto &ctx = Impl::ctxs.emplace_back();
-
-                // Initialize the quad buffer
-                ctx.v_positions.replace(normalized_positions_data, 4 * 2 * sizeof(float));
-
-                // Initialize vertex attributes
-                ctx.vao.add_attribute<VertexAttr::VEC2>(ctx.v_positions);
-                ctx.vao.add_attribute<VertexAttr::VEC2>(ctx.v_tex_coords);
-                ctx.vao.add_attribute<VertexAttr::MAT3, 1>(ctx.s_transforms);
-                ctx.vao.add_attribute<VertexAttr::VEC4, 1>(ctx.s_tints);
-            }
-            ++last_used_ctx_index;
-
-            // Shaders
-            static const auto vertex_shader = VertexShader(vertex_shader_source);
-            static const auto fragment_shader = FragmentShader(fragment_shader_source);
-            static const auto program = Program(vertex_shader, fragment_shader);
-            program.use();
+        explicit Impl(SpriteTransform transform) : recording(transform) {}
+
+    private:
+        SpriteRecording recording;
+
+        friend SpriteRecorder;
+        friend SpriteBatch;
+        friend StaticSpriteBatch;
+    };
+
+    SpriteRecorder::SpriteRecorder(SpriteTransform transform) : impl(std::make_unique<Impl>(transform)) {}
+
+    SpriteRecorder::SpriteRecorder(SpriteRecorder &&recorder) noexcept = default;
+
+    SpriteRecorder &SpriteRecorder::operator=(SpriteRecorder &&recorder) noexcept = default;
 
-            static const auto texture_location = program.get_uniform_location("tex");
-            static const auto width_location = program.get_uniform_location("width");
-            static const auto height_location = program.get_uniform_location("height");
+    void SpriteRecorder::clear() { impl->recording.clear(); }
 
-            glUniform1i(texture_location, Impl::TEXTURE_SLOT);
-            glUniform1i(height_location, kex::logical_viewport_h);
-            glUniform1i(width_location, kex::logical_viewport_w);
+    void SpriteRecorder::add(const Sprite &sprite, int layer) {
+        check_layer(layer);
+        impl->recording.add(sprite, layer);
+    }
+
+    void SpriteRecorder::add(const SpritePool &pool, int layer) {
+        check_layer(layer);
+        impl->recording.add(pool, layer);
+    }
+
+    SpriteRecorder::~SpriteRecorder() = default;
+
+    static int texture_slots() {
+        static const int slots = [] {
+            GLint max_units = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+            return std::min(static_cast<int>(max_units), MAX_TEXTURE_SLOTS);
+        }();
+        return slots;
+    }
+
+    static const FragmentShader &fragment_shader(SpriteProgram program) {
+        static const FragmentShader fragment_shaders[] = {
+                FragmentShader(fragment_shader_source(SpriteProgram::TEXTURE, texture_slots())),
+                FragmentShader(fragment_shader_source(SpriteProgram::TEXTURE_ARRAY, texture_slots())),
+        };
+        return fragment_shaders[program];
+    }
+
+    static const SpriteProgramCtx &program_ctx(SpriteTransform transform, SpriteProgram program) {
+        // Programs of each transform mode are only built once the mode is used
+        if (transform == SpriteTransform::GPU) {
+            static const auto vertex_shader = VertexShader(vertex_shader_source(SpriteTransform::GPU));
+            static const SpriteProgramCtx programs[] = {
+                    SpriteProgramCtx(vertex_shader, fragment_shader(SpriteProgram::TEXTURE), texture_slots()),
+                    SpriteProgramCtx(vertex_shader, fragment_shader(SpriteProgram::TEXTURE_ARRAY), texture_slots()),
+            };
+            return programs[program];
+        }
+        static const auto vertex_shader = VertexShader(vertex_shader_source(SpriteTransform::CPU));
+        static const SpriteProgramCtx programs[] = {
+                SpriteProgramCtx(vertex_shader, fragment_shader(SpriteProgram::TEXTURE), texture_slots()),
+                SpriteProgramCtx(vertex_shader, fragment_shader(SpriteProgram::TEXTURE_ARRAY), texture_slots()),
         };
+        return programs[program];
+    }
+
+    static void use_program(SpriteTransform transform, SpriteProgram program, const std::array<float, 3 * 2> &view) {
+        const auto &selected = program_ctx(transform, program);
+        selected.program.use();
+        StateCache::set_uniform(selected.width_location, kex::logical_viewport_w);
+        StateCache::set_uniform(selected.height_location, kex::logical_viewport_h);
+        if (view != selected.view) {
+            glUniformMatrix3x2fv(selected.view_location, 1, GL_FALSE, view.data());
+            selected.view = view;
+        }
+    }
+
+    /**
+     * Consecutive sorted instances drawn by a single draw call.
+     */
+    struct SpriteRun {
+        SpriteProgram program;
+        std::size_t start;
+        std::size_t count;
+        int used_slots;
+        std::array<TextureHandle, MAX_TEXTURE_SLOTS> slot_textures;
+    };
 
-        void add(const Sprite &sprite) {
-            const auto &texture = sprite.texture();
-            auto &group_data = groups[texture.id()];
-            group_data.texture_id = texture.id();
-            const auto transform = sprite.transform();
-            group_data.s_transforms.insert(
-                    group_data.s_transforms.end(),
-                    transform.begin(), transform.end()
-            );
-            group_data.v_tex_coords.insert(
-                    group_data.v_tex_coords.end(),
-                    {
-                            sprite.u_min(), sprite.v_min(),
-                            sprite.u_max(), sprite.v_min(),
-                            sprite.u_min(), sprite.v_max(),
-                            sprite.u_max(), sprite.v_max(),
+    /**
+     * Sort the recorded instances into the draw order and split them into runs.
+     *
+     * Every run of instances sharing the same program is drawn at once, as long as its textures fit into the available
+     * texture slots. Sorted instances are written to the destination back-to-back, each exactly once and in order, with
+     * their texture slots assigned. The destination can therefore be mapped buffer memory.
+     */
+    static void arrange_sprites(SpriteRecording &recording, std::vector<SpriteSortEntry> &entries_scratch,
+                                SpriteInstance *sorted_instances, std::vector<SpriteRun> &runs) {
+        auto &entries = recording.entries;
+        const auto &instances = recording.instances;
+        radix_sort(entries, entries_scratch);
+        runs.clear();
+
+        const auto slots = texture_slots();
+        std::size_t run_start = 0;
+        while (run_start < entries.size()) {
+            auto &run = runs.emplace_back();
+            run.program = sort_key_program(entries[run_start].key);
+            run.start = run_start;
+            run.used_slots = 0;
+            int slot = -1;
+            auto run_end = run_start;
+            for (; run_end < entries.size(); ++run_end) {
+                const auto &entry = entries[run_end];
+                if (sort_key_program(entry.key) != run.program) break;
+
+                // Entries of the same texture are adjacent within a layer
+                const auto texture = sort_key_texture(entry.key);
+                if (slot == -1 || run.slot_textures[slot] != texture) {
+                    slot = 0;
+                    while (slot < run.used_slots && run.slot_textures[slot] != texture) ++slot;
+                    if (slot == run.used_slots) {
+                        if (run.used_slots == slots) break;
+                        run.slot_textures[run.used_slots++] = texture;
                     }
-            );
-            group_data.s_tints.insert(
-                    group_data.s_tints.end(),
-                    {
-                            sprite.tint_r,
-                            sprite.tint_g,
-                            sprite.tint_b,
-                            sprite.tint_a,
-                    }
-            );
+                }
 
-            ++group_data.instance_count;
+                auto instance = instances[entry.index];
+                instance.tex_slot = static_cast<std::uint16_t>(slot);
+                sorted_instances[run_end] = instance;
+            }
+            run.count = run_end - run_start;
+            run_start = run_end;
+        }
+    }
+
+    /**
+     * Draw a run whose instances the vertex array points at.
+     */
+    static void draw_sprite_run(const SpriteRun &run, const VertexArray &vao, SpriteTransform transform,
+                                const std::array<float, 3 * 2> &view, int &current_program) {
+        if (run.program != current_program) {
+            use_program(transform, run.program, view);
+            current_program = run.program;
         }
 
-        ~Impl() {
+        vao.bind();
+        for (int unit = 0; unit < run.used_slots; ++unit) {
+            const auto id = TextureRegistry::get(run.slot_textures[unit]).id;
+            if (run.program == SpriteProgram::TEXTURE_ARRAY) {
+                TextureArray::bind(id, unit);
+            } else {
+                Texture::bind(id, unit);
+            }
+        }
+        glDrawArraysInstanced(
+                GL_TRIANGLE_STRIP,
+                0, 4, run.count // NOLINT(cppcoreguidelines-narrowing-conversions)
+        );
+    }
+
+    /**
+     * Record the use of the textures of all runs in the current frame, reloading evicted ones or queueing them for a
+     * TextureLoader.
+     */
+    static void use_textures(const std::vector<SpriteRun> &runs) {
+        for (const auto &run: runs) {
+            for (int unit = 0; unit < run.used_slots; ++unit) {
+                TextureRegistry::use(run.slot_textures[unit]);
+            }
+        }
+        TextureRegistry::reload_queued();
+    }
 
-            for (const auto &[texture_id, data]: groups) {
-                auto &ctx = Impl::ctxs[ctx_index];
-                ctx.v_tex_coords.orphan(data.instance_count * 4 * 2 * sizeof(float));
-                ctx.v_tex_coords.update(data.v_tex_coords.data(), data.v_tex_coords.size() * sizeof(float));
+    class SpriteBatch::Impl {
+    public:
+        explicit Impl(SpriteTransform transform) : ctx(transform), recording(transform) {}
+
+        void begin() {
+            recording.clear();
+            submitted.clear();
+            culled = 0;
+            accepted = 0;
+            view = camera.view();
+        }
 
-                ctx.s_transforms.orphan(data.instance_count * 3 * 3 * sizeof(float));
-                ctx.s_transforms.update(data.s_transforms.data(), data.s_transforms.size() * sizeof(float));
+        void set_camera(const Camera &new_camera) {
+            camera = new_camera;
+            view = camera.view();
+        }
 
-                ctx.s_tints.orphan(data.instance_count * 4 * sizeof(float));
-                ctx.s_tints.update(data.s_tints.data(), data.s_tints.size() * sizeof(float));
+        void add(const Sprite &sprite, int layer) {
+            if (!is_culling) {
+                ++accepted;
+                recording.add(sprite, layer);
+                return;
+            }
 
-                ctx.vao.bind();
-                Texture::bind(data.texture_id);
-                glDrawArraysInstanced(
-                        GL_TRIANGLE_STRIP,
-                        0, 4, data.instance_count // NOLINT(cppcoreguidelines-narrowing-conversions)
-                );
+            // The matrix needed for culling in the CPU mode is computed once and recorded as is
+            const auto is_cpu = recording.transform == SpriteTransform::CPU;
+            const auto matrix = is_cpu ? recording.transforms.transform(sprite, sprite.texture_region())
+                                       : std::array<float, 3 * 2>{};
+            if (is_culled(sprite, is_cpu ? &matrix : nullptr)) {
+                ++culled;
+                return;
+            }
+            ++accepted;
+            recording.add(sprite, layer, is_cpu ? &matrix : nullptr);
+        }
+
+        void add(const SpritePool &pool, int layer) {
+            recording.add(pool, layer);
+        }
 
-                --last_used_ctx_index;
+        void submit(const SpriteRecording &submitted_recording) {
+            if (submitted_recording.transform != recording.transform) {
+                throw std::invalid_argument("Transform mode of the recorder does not match the sprite batch");
             }
+            submitted.push_back(&submitted_recording);
         }
 
-    private:
-        std::unordered_map<unsigned int, SpriteBatchGroupData> groups;
-        int ctx_index = -1;
+        void flush() {
+            // Merge the submitted recordings in the order of submission, which keeps the draw order deterministic
+            for (const auto *submitted_recording: submitted) {
+                recording.append(*submitted_recording);
+            }
+            submitted.clear();
 
-        static const int TEXTURE_SLOT = 0;
+            if (recording.entries.empty()) return;
+            view = camera.view();
 
-        static std::vector<SpriteBatchCtx> ctxs;
-        static int last_used_ctx_index;
+            // All runs are sorted straight into a single mapped range, which makes one upload per flush
+            const int size = static_cast<int>(recording.instances.size() * sizeof(SpriteInstance));
+            int offset;
+            auto *mapped = static_cast<SpriteInstance *>(ctx.s_instances.map(size, offset));
+            if (mapped == nullptr) {
+                throw std::runtime_error("Could not map the sprite instance buffer.");
+            }
+            arrange_sprites(recording, entries_scratch, mapped, runs);
+            ctx.s_instances.unmap();
+            use_textures(runs);
+
+            int current_program = -1;
+            for (const auto &run: runs) {
+                // Point the instance attributes at the run, which emulates a base instance
+                ctx.vao.rebase(ctx.s_instances.buffer(), offset + static_cast<int>(run.start * sizeof(SpriteInstance)));
+                draw_sprite_run(run, ctx.vao, recording.transform, view, current_program);
+            }
+        }
+
+    private:
+        SpriteBatchCtx ctx;
+        SpriteRecording recording;
+        Camera camera;
+        std::array<float, 3 * 2> view = camera.view();
+        bool is_culling = false;
+        std::size_t culled = 0;
+        std::size_t accepted = 0;
+        std::vector<const SpriteRecording *> submitted;
+        std::vector<SpriteSortEntry> entries_scratch;
+        std::vector<SpriteRun> runs;
+
+        /**
+         * Conservatively check whether a sprite is invisible: fully transparent, degenerate or with its axis-aligned
+         * bounding box outside the logical viewport after applying the camera.
+         *
+         * @param matrix Transform of the sprite in the CPU mode, null in the GPU mode
+         */
+        [[nodiscard]] bool is_culled(const Sprite &sprite, const std::array<float, 3 * 2> *matrix) const {
+            if (pack_unorm8(sprite.tint_a) == 0) return true;
+
+            float extent_x, extent_y;
+            if (matrix == nullptr) {
+                // Bound the sprite by a circle to avoid the trigonometry the GPU mode is meant to skip. The rotated
+                // corners are at most half the diagonal away from the center, which the shear and scale stretch by at
+                // most the Frobenius norm of their matrix.
+                const auto w_scaled = static_cast<float>(sprite.width()) * sprite.scale_x;
+                const auto h_scaled = static_cast<float>(sprite.height()) * sprite.scale_y;
+                if (w_scaled * h_scaled - sprite.shear_x * sprite.shear_y == 0.f) return true;
+                extent_x = std::sqrt(0.5f * (w_scaled * w_scaled + sprite.shear_y * sprite.shear_y +
+                                             sprite.shear_x * sprite.shear_x + h_scaled * h_scaled));
+                extent_y = extent_x;
+            } else {
+                const auto &transform = *matrix;
+                if (transform[0] * transform[3] - transform[2] * transform[1] == 0.f) return true;
+                extent_x = 0.5f * (std::abs(transform[0]) + std::abs(transform[2]));
+                extent_y = 0.5f * (std::abs(transform[1]) + std::abs(transform[3]));
+            }
+
+            // Bounding box of the bounding box in the view
+            const auto center_x = view[0] * sprite.x + view[2] * sprite.y + view[4];
+            const auto center_y = view[1] * sprite.x + view[3] * sprite.y + view[5];
+            const auto view_extent_x = std::abs(view[0]) * extent_x + std::abs(view[2]) * extent_y;
+            const auto view_extent_y = std::abs(view[1]) * extent_x + std::abs(view[3]) * extent_y;
+            const auto viewport_w = static_cast<float>(kex::logical_viewport_w);
+            const auto viewport_h = static_cast<float>(kex::logical_viewport_h);
+            return center_x + view_extent_x < 0.f || center_x - view_extent_x > viewport_w ||
+                   center_y + view_extent_y < 0.f || center_y - view_extent_y > viewport_h;
+        }
 
         friend SpriteBatch;
     };
 
-    std::vector<SpriteBatchCtx> SpriteBatch::Impl::ctxs;
-    int SpriteBatch::Impl::last_used_ctx_index = -1;
-
-    SpriteBatch::SpriteBatch() : impl(std::make_unique<Impl>()) {}
+    SpriteBatch::SpriteBatch(SpriteTransform transform) : impl(std::make_unique<Impl>(transform)) {}
 
     SpriteBatch::~SpriteBatch() = default;
 
-    void SpriteBatch::add(const Sprite &sprite) { impl->add(sprite); }
+    void SpriteBatch::begin() { impl->begin(); }
+
+    void SpriteBatch::add(const Sprite &sprite, int layer) {
+        check_layer(layer);
+        impl->add(sprite, layer);
+    }
+
+    void SpriteBatch::add(const SpritePool &pool, int layer) {
+        check_layer(layer);
+        impl->add(pool, layer);
+    }
+
+    void SpriteBatch::submit(const SpriteRecorder &recorder) { impl->submit(recorder.impl->recording); }
+
+    void SpriteBatch::flush() { impl->flush(); }
+
+    void SpriteBatch::set_camera(const Camera &camera) { impl->set_camera(camera); }
+
+    void SpriteBatch::set_culling(bool enabled) { impl->is_culling = enabled; }
+
+    std::size_t SpriteBatch::culled_sprites() const { return impl->culled; }
+
+    std::size_t SpriteBatch::accepted_sprites() const { return impl->accepted; }
+
+    class StaticSpriteBatch::Impl {
+    public:
+        explicit Impl(const SpriteRecording &source) : transform(source.transform) {
+            // The recorder stays untouched, its sprites are sorted in a copy
+            auto recording = source;
+            std::vector<SpriteSortEntry> entries_scratch;
+            std::vector<SpriteInstance> sorted_instances(recording.instances.size());
+            arrange_sprites(recording, entries_scratch, sorted_instances.data(), runs);
+            if (sorted_instances.empty()) return;
+
+            s_instances.replace(sorted_instances.data(),
+                                static_cast<int>(sorted_instances.size() * sizeof(SpriteInstance)));
+
+            // Each run gets its own vertex array pointing at its instances, so drawing does not respecify attributes
+            vaos.reserve(runs.size());
+            for (const auto &run: runs) {
+                auto &vao = vaos.emplace_back();
+                add_sprite_attributes(vao, v_positions, s_instances, transform,
+                                      static_cast<int>(run.start * sizeof(SpriteInstance)));
+            }
+        }
+
+        void draw() const {
+            use_textures(runs);
+            const auto view = camera.view();
+            int current_program = -1;
+            for (std::size_t i = 0; i < runs.size(); ++i) {
+                draw_sprite_run(runs[i], vaos[i], transform, view, current_program);
+            }
+        }
+
+    private:
+        const SpriteTransform transform;
+        Camera camera;
+        StaticArrayBuffer v_positions = make_quad_buffer();
+        StaticArrayBuffer s_instances;
+        std::vector<SpriteRun> runs;
+        std::vector<VertexArray> vaos;
+
+        friend StaticSpriteBatch;
+    };
+
+    StaticSpriteBatch::StaticSpriteBatch(const SpriteRecorder &recorder) : impl(
+            std::make_unique<Impl>(recorder.impl->recording)) {}
+
+    StaticSpriteBatch::StaticSpriteBatch(StaticSpriteBatch &&batch) noexcept = default;
+
+    StaticSpriteBatch &StaticSpriteBatch::operator=(StaticSpriteBatch &&batch) noexcept = default;
+
+    void StaticSpriteBatch::set_camera(const Camera &camera) { impl->camera = camera; }
+
+    void StaticSpriteBatch::draw() const { impl->draw(); }
+
+    StaticSpriteBatch::~StaticSpriteBatch() = default;
 }
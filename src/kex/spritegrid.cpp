@@ -0,0 +1,237 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <kex/spritegrid.hpp>
+
+#include "spritesort.hpp"
+
+namespace kex {
+
+    class SpriteGrid::Impl {
+    public:
+        explicit Impl(float cell_size) : cell_size(cell_size) {
+            if (!(cell_size > 0.f)) {
+                throw std::invalid_argument("Cell size of a sprite grid must be positive");
+            }
+        }
+
+    private:
+        /** Key of the list of sprites larger than a cell. */
+        static constexpr std::uint64_t LARGE = ~std::uint64_t{0};
+
+        /** Bound of cell coordinates, which keeps keys of cells distinct from LARGE. */
+        static constexpr int CELL_LIMIT = 1 << 30;
+
+        struct Entry {
+            const Sprite *sprite;
+            int layer;
+            float min_x, min_y, max_x, max_y;
+            std::uint64_t cell;
+            std::size_t position;
+        };
+
+        const float cell_size;
+        std::vector<Entry> entries;
+        std::unordered_map<const Sprite *, std::size_t> indices;
+        std::unordered_map<std::uint64_t, std::vector<std::size_t>> cells;
+
+        [[nodiscard]] int cell_coordinate(float value) const {
+            constexpr auto limit = static_cast<float>(CELL_LIMIT);
+            const auto cell = static_cast<int>(std::clamp(std::floor(value / cell_size), -limit, limit));
+
+            // CELL_LIMIT - 1 is not representable as a float, and CELL_LIMIT itself would overflow cell_key()
+            return std::min(cell, CELL_LIMIT - 1);
+        }
+
+        static std::uint64_t cell_key(int cell_x, int cell_y) {
+            return static_cast<std::uint64_t>(cell_x + CELL_LIMIT) << 32 |
+                   static_cast<std::uint64_t>(cell_y + CELL_LIMIT);
+        }
+
+        /**
+         * Update the axis-aligned bounding box of the sprite and compute the cell it belongs to.
+         */
+        std::uint64_t locate(Entry &entry) const {
+            const auto &sprite = *entry.sprite;
+            const auto transform = sprite.transform();
+            const auto extent_x = 0.5f * (std::abs(transform[0]) + std::abs(transform[3]));
+            const auto extent_y = 0.5f * (std::abs(transform[1]) + std::abs(transform[4]));
+            entry.min_x = sprite.x - extent_x;
+            entry.max_x = sprite.x + extent_x;
+            entry.min_y = sprite.y - extent_y;
+            entry.max_y = sprite.y + extent_y;
+
+            // A sprite fits into the cell margin visited by queries only if it is at most as large as a cell
+            const auto half_cell = 0.5f * cell_size;
+            if (extent_x > half_cell || extent_y > half_cell) return LARGE;
+            return cell_key(cell_coordinate(sprite.x), cell_coordinate(sprite.y));
+        }
+
+        void link(std::size_t index) {
+            auto &cell = cells[entries[index].cell];
+            entries[index].position = cell.size();
+            cell.push_back(index);
+        }
+
+        void unlink(std::size_t index) {
+            const auto &entry = entries[index];
+            const auto cell_it = cells.find(entry.cell);
+            auto &cell = cell_it->second;
+            const auto last = cell.back();
+            cell[entry.position] = last;
+            entries[last].position = entry.position;
+            cell.pop_back();
+            if (cell.empty()) cells.erase(cell_it);
+        }
+
+        /**
+         * Make sure that the position of a sprite can be converted to a cell.
+         */
+        static void check_position(const Sprite &sprite) {
+            if (!std::isfinite(sprite.x) || !std::isfinite(sprite.y)) {
+                throw std::invalid_argument("Position of a sprite in the grid must be finite");
+            }
+        }
+
+        std::size_t find(const Sprite &sprite) const {
+            const auto it = indices.find(&sprite);
+            if (it == indices.end()) {
+                throw std::invalid_argument("Sprite is not in the grid");
+            }
+            return it->second;
+        }
+
+        void insert(const Sprite &sprite, int layer) {
+            if (indices.count(&sprite) != 0) {
+                throw std::invalid_argument("Sprite is already in the grid");
+            }
+            check_layer(layer);
+            check_position(sprite);
+            const auto index = entries.size();
+            auto &entry = entries.emplace_back();
+            entry.sprite = &sprite;
+            entry.layer = layer;
+            entry.cell = locate(entry);
+            indices.emplace(&sprite, index);
+            link(index);
+        }
+
+        void move(const Sprite &sprite) {
+            const auto index = find(sprite);
+            check_position(sprite);
+            const auto cell = locate(entries[index]);
+            if (cell != entries[index].cell) {
+                unlink(index);
+                entries[index].cell = cell;
+                link(index);
+            }
+        }
+
+        void remove(const Sprite &sprite) {
+            const auto index = find(sprite);
+            unlink(index);
+            indices.erase(&sprite);
+
+            // Fill the gap with the last entry
+            const auto last = entries.size() - 1;
+            if (index != last) {
+                entries[index] = entries[last];
+                cells[entries[index].cell][entries[index].position] = index;
+                indices[entries[index].sprite] = index;
+            }
+            entries.pop_back();
+        }
+
+        void clear() {
+            entries.clear();
+            indices.clear();
+            cells.clear();
+        }
+
+        std::size_t add_overlapping(const std::vector<std::size_t> &cell, float min_x, float min_y,
+                                    float max_x, float max_y, SpriteBatch &batch) const {
+            std::size_t added = 0;
+            for (const auto index: cell) {
+                const auto &entry = entries[index];
+                if (entry.max_x < min_x || entry.min_x > max_x || entry.max_y < min_y || entry.min_y > max_y) continue;
+                batch.add(*entry.sprite, entry.layer);
+                ++added;
+            }
+            return added;
+        }
+
+        std::size_t query(const RectangleDef &view, SpriteBatch &batch) const {
+            const auto min_x = static_cast<float>(view.x);
+            const auto min_y = static_cast<float>(view.y);
+            const auto max_x = static_cast<float>(view.x + view.w);
+            const auto max_y = static_cast<float>(view.y + view.h);
+
+            std::size_t added = 0;
+            const auto large_it = cells.find(LARGE);
+            if (large_it != cells.end()) {
+                added += add_overlapping(large_it->second, min_x, min_y, max_x, max_y, batch);
+            }
+
+            // Sprites in cells up to half a cell away from the view can still overlap it
+            const auto half_cell = 0.5f * cell_size;
+            const auto cell_min_x = cell_coordinate(min_x - half_cell);
+            const auto cell_max_x = cell_coordinate(max_x + half_cell);
+            const auto cell_min_y = cell_coordinate(min_y - half_cell);
+            const auto cell_max_y = cell_coordinate(max_y + half_cell);
+            for (auto cell_y = cell_min_y; cell_y <= cell_max_y; ++cell_y) {
+                for (auto cell_x = cell_min_x; cell_x <= cell_max_x; ++cell_x) {
+                    const auto cell_it = cells.find(cell_key(cell_x, cell_y));
+                    if (cell_it == cells.end()) continue;
+                    added += add_overlapping(cell_it->second, min_x, min_y, max_x, max_y, batch);
+                }
+            }
+            return added;
+        }
+
+        friend SpriteGrid;
+    };
+
+    SpriteGrid::SpriteGrid(float cell_size) : impl(std::make_unique<Impl>(cell_size)) {}
+
+    SpriteGrid::SpriteGrid(SpriteGrid &&grid) noexcept = default;
+
+    SpriteGrid &SpriteGrid::operator=(SpriteGrid &&grid) noexcept = default;
+
+    void SpriteGrid::insert(const Sprite &sprite, int layer) { impl->insert(sprite, layer); }
+
+    void SpriteGrid::move(const Sprite &sprite) { impl->move(sprite); }
+
+    void SpriteGrid::remove(const Sprite &sprite) { impl->remove(sprite); }
+
+    void SpriteGrid::clear() { impl->clear(); }
+
+    std::size_t SpriteGrid::size() const { return impl->entries.size(); }
+
+    std::size_t SpriteGrid::query(const RectangleDef &view, SpriteBatch &batch) const {
+        return impl->query(view, batch);
+    }
+
+    SpriteGrid::~SpriteGrid() = default;
+
+}
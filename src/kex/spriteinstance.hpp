@@ -0,0 +1,99 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_SPRITEINSTANCE_HPP
+#define KEX_SPRITEINSTANCE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace kex {
+
+    /**
+     * Per-instance sprite data, interleaved in a single buffer.
+     *
+     * Depending on the transform mode of the batch, the instance carries either the transform matrix without the
+     * constant last row of the homogeneous matrix, or the raw parameters the vertex shader composes the matrix from.
+     * Texture regions are normalized unsigned shorts and the tint is a normalized RGBA8 color.
+     */
+    struct SpriteInstance {
+        union {
+            /** Transform matrix, see SpriteTransform::CPU. */
+            float transform[3 * 2];
+
+            /** Transform parameters, see SpriteTransform::GPU. Shear factors are half-precision floats. */
+            struct {
+                float x, y;
+                float w_scaled, h_scaled;
+                float rotation;
+                std::uint16_t shear[2];
+            } parameters;
+        };
+        std::uint16_t tex_region[4];
+        std::uint8_t tint[4];
+        std::uint16_t tex_layer;
+        std::uint16_t tex_slot;
+    };
+
+    static inline std::uint16_t pack_unorm16(float value) {
+        return static_cast<std::uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+    }
+
+    static inline std::uint8_t pack_unorm8(float value) {
+        return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+    }
+
+    /**
+     * Convert a float to a half-precision float, rounding to the nearest even value.
+     */
+    static inline std::uint16_t pack_half(float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        const auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+        const auto exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+        auto mantissa = bits & 0x7FFFFF;
+
+        if (exponent >= 0x1F) {
+            // Infinity and NaN are kept, finite values too large for a half become infinity
+            const bool is_nan = ((bits >> 23) & 0xFF) == 0xFF && mantissa != 0;
+            return sign | 0x7C00 | (is_nan ? 0x200 : 0);
+        }
+        if (exponent <= 0) {
+            // Subnormal half or zero
+            if (exponent < -10) return sign;
+            mantissa |= 0x800000;
+            const auto shift = 14 - exponent;
+            auto half = mantissa >> shift;
+            const auto remainder = mantissa & ((1u << shift) - 1);
+            const auto halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (half & 1))) ++half;
+            return sign | static_cast<std::uint16_t>(half);
+        }
+
+        auto half = static_cast<std::uint32_t>(exponent) << 10 | mantissa >> 13;
+        const auto remainder = mantissa & 0x1FFF;
+        // A carry out of the mantissa correctly increments the exponent, up to infinity
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) ++half;
+        return sign | static_cast<std::uint16_t>(half);
+    }
+
+}
+
+#endif //KEX_SPRITEINSTANCE_HPP
@@ -0,0 +1,244 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <kex/spritepool.hpp>
+
+#include "spriteinstance.hpp"
+#include "spritesimd.hpp"
+#include "textureregistry.hpp"
+
+namespace kex {
+
+    class SpritePool::Impl {
+    public:
+        explicit Impl(const Texture &texture) : texture(&texture) {
+            add_region({0, 0, texture.width(), texture.height()});
+        }
+
+    private:
+        struct Region {
+            float w, h;
+            /** Index of the region in the registry, whose texture coordinates change when the texture is resized. */
+            std::uint16_t index;
+        };
+
+        const Texture *texture;
+        std::vector<Region> regions;
+        std::vector<float> x, y, rotation, scale_x, scale_y, shear_x, shear_y;
+        std::vector<std::uint32_t> tint;
+        std::vector<int> region;
+
+        int add_region(const RectangleDef &rectangle) {
+            auto &added = regions.emplace_back();
+            added.w = static_cast<float>(rectangle.w);
+            added.h = static_cast<float>(rectangle.h);
+            added.index = TextureRegistry::region(texture->handle(), rectangle);
+            return static_cast<int>(regions.size() - 1);
+        }
+
+        /**
+         * Current table of the texture regions, from which the texture coordinates are read when writing instances,
+         * since they follow the size and orientation of the texture.
+         */
+        [[nodiscard]] const TextureRegionTable &region_table() const {
+            return *TextureRegistry::get(texture->handle()).region_table.load(std::memory_order_acquire);
+        }
+
+        template<typename Function>
+        void for_each_array(Function function) {
+            function(x);
+            function(y);
+            function(rotation);
+            function(scale_x);
+            function(scale_y);
+            function(shear_x);
+            function(shear_y);
+            function(tint);
+            function(region);
+        }
+
+        /**
+         * Compute the instances of sprites in the range [start, end) with the specified operations, in steps of
+         * their width.
+         */
+        template<typename Ops>
+        void write_instances(std::size_t start, std::size_t end, SpriteInstance *instances) const {
+            using F = typename Ops::F;
+            constexpr int width = Ops::width;
+            float w_values[width], h_values[width];
+            float m0[width], m1[width], m2[width], m3[width];
+            const auto &table = region_table();
+
+            for (auto i = start; i + width <= end; i += width) {
+                for (int lane = 0; lane < width; ++lane) {
+                    const auto &sprite_region = regions[region[i + lane]];
+                    w_values[lane] = sprite_region.w;
+                    h_values[lane] = sprite_region.h;
+                }
+
+                // Same matrix as Sprite::transform()
+                F sin, cos;
+                sincos<Ops>(Ops::load(&rotation[i]), sin, cos);
+                const F w_scaled = Ops::mul(Ops::load(w_values), Ops::load(&scale_x[i]));
+                const F h_scaled = Ops::mul(Ops::load(h_values), Ops::load(&scale_y[i]));
+                const F sx = Ops::load(&shear_x[i]);
+                const F sy = Ops::load(&shear_y[i]);
+                Ops::store(m0, Ops::sub(Ops::mul(w_scaled, cos), Ops::mul(sx, sin)));
+                Ops::store(m1, Ops::sub(Ops::mul(sy, cos), Ops::mul(h_scaled, sin)));
+                Ops::store(m2, Ops::add(Ops::mul(w_scaled, sin), Ops::mul(sx, cos)));
+                Ops::store(m3, Ops::add(Ops::mul(sy, sin), Ops::mul(h_scaled, cos)));
+
+                for (int lane = 0; lane < width; ++lane) {
+                    const auto index = i + lane;
+                    auto &instance = instances[index];
+                    instance.transform[0] = m0[lane];
+                    instance.transform[1] = m1[lane];
+                    instance.transform[2] = m2[lane];
+                    instance.transform[3] = m3[lane];
+                    instance.transform[4] = x[index];
+                    instance.transform[5] = y[index];
+                    std::memcpy(instance.tex_region, table.regions[regions[region[index]].index].packed,
+                                sizeof(instance.tex_region));
+                    std::memcpy(instance.tint, &tint[index], sizeof(instance.tint));
+                    instance.tex_layer = 0;
+                    instance.tex_slot = 0;
+                }
+            }
+        }
+
+        void write_parameters(SpriteInstance *instances) const {
+            const auto &table = region_table();
+            for (std::size_t i = 0; i < x.size(); ++i) {
+                const auto &sprite_region = regions[region[i]];
+                auto &instance = instances[i];
+                auto &parameters = instance.parameters;
+                parameters.x = x[i];
+                parameters.y = y[i];
+                parameters.w_scaled = sprite_region.w * scale_x[i];
+                parameters.h_scaled = sprite_region.h * scale_y[i];
+                parameters.rotation = rotation[i];
+                parameters.shear[0] = pack_half(shear_x[i]);
+                parameters.shear[1] = pack_half(shear_y[i]);
+                std::memcpy(instance.tex_region, table.regions[sprite_region.index].packed,
+                            sizeof(instance.tex_region));
+                std::memcpy(instance.tint, &tint[i], sizeof(instance.tint));
+                instance.tex_layer = 0;
+                instance.tex_slot = 0;
+            }
+        }
+
+        void write_instances(SpriteInstance *instances) const {
+            const auto size = x.size();
+            const auto simd_end = size - size % SimdOps::width;
+            write_instances<SimdOps>(0, simd_end, instances);
+            write_instances<ScalarOps>(simd_end, size, instances);
+        }
+
+        friend SpritePool;
+    };
+
+    SpritePool::SpritePool(const Texture &texture) : impl(std::make_unique<Impl>(texture)) {}
+
+    SpritePool::SpritePool(SpritePool &&pool) noexcept = default;
+
+    SpritePool &SpritePool::operator=(SpritePool &&pool) noexcept = default;
+
+    int SpritePool::add_region(const RectangleDef &region) { return impl->add_region(region); }
+
+    std::size_t SpritePool::add(float x, float y, int region) {
+        if (region < 0 || static_cast<std::size_t>(region) >= impl->regions.size()) {
+            throw std::out_of_range("Sprite pool has no region " + std::to_string(region));
+        }
+        impl->x.push_back(x);
+        impl->y.push_back(y);
+        impl->rotation.push_back(0.f);
+        impl->scale_x.push_back(1.f);
+        impl->scale_y.push_back(1.f);
+        impl->shear_x.push_back(0.f);
+        impl->shear_y.push_back(0.f);
+        impl->tint.push_back(pack_tint(1.f, 1.f, 1.f, 1.f));
+        impl->region.push_back(region);
+        return impl->x.size() - 1;
+    }
+
+    void SpritePool::remove(std::size_t index) {
+        if (index >= impl->x.size()) {
+            throw std::out_of_range("Sprite pool has no sprite " + std::to_string(index));
+        }
+        impl->for_each_array([index](auto &array) {
+            array[index] = array.back();
+            array.pop_back();
+        });
+    }
+
+    void SpritePool::clear() {
+        impl->for_each_array([](auto &array) { array.clear(); });
+    }
+
+    void SpritePool::reserve(std::size_t capacity) {
+        impl->for_each_array([capacity](auto &array) { array.reserve(capacity); });
+    }
+
+    std::size_t SpritePool::size() const { return impl->x.size(); }
+
+    const Texture &SpritePool::texture() const { return *impl->texture; }
+
+    void SpritePool::set_tint(std::size_t index, float r, float g, float b, float a) {
+        impl->tint[index] = pack_tint(r, g, b, a);
+    }
+
+    std::uint32_t SpritePool::pack_tint(float r, float g, float b, float a) {
+        const std::uint8_t components[] = {pack_unorm8(r), pack_unorm8(g), pack_unorm8(b), pack_unorm8(a)};
+        std::uint32_t packed;
+        std::memcpy(&packed, components, sizeof(packed));
+        return packed;
+    }
+
+    float *SpritePool::x() { return impl->x.data(); }
+
+    float *SpritePool::y() { return impl->y.data(); }
+
+    float *SpritePool::rotation() { return impl->rotation.data(); }
+
+    float *SpritePool::scale_x() { return impl->scale_x.data(); }
+
+    float *SpritePool::scale_y() { return impl->scale_y.data(); }
+
+    float *SpritePool::shear_x() { return impl->shear_x.data(); }
+
+    float *SpritePool::shear_y() { return impl->shear_y.data(); }
+
+    std::uint32_t *SpritePool::tint() { return impl->tint.data(); }
+
+    int *SpritePool::region() { return impl->region.data(); }
+
+    void SpritePool::write_instances(SpriteInstance *instances, SpriteTransform transform) const {
+        if (transform == SpriteTransform::GPU) {
+            impl->write_parameters(instances);
+        } else {
+            impl->write_instances(instances);
+        }
+    }
+
+    SpritePool::~SpritePool() = default;
+
+}
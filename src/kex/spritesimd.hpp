@@ -0,0 +1,192 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_SPRITESIMD_HPP
+#define KEX_SPRITESIMD_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define KEX_SIMD_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+    #define KEX_SIMD_NEON
+    #include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+    #define KEX_SIMD_WASM
+    #include <wasm_simd128.h>
+#endif
+
+namespace kex {
+
+    /**
+     * Vector operations on one lane, used for the tail of the pool and when no SIMD instructions are available.
+     */
+    struct ScalarOps {
+        static constexpr int width = 1;
+        using F = float;
+        using I = std::uint32_t;
+
+        static F load(const float *values) { return *values; }
+        static void store(float *values, F v) { *values = v; }
+        static F set(float value) { return value; }
+        static F add(F a, F b) { return a + b; }
+        static F sub(F a, F b) { return a - b; }
+        static F mul(F a, F b) { return a * b; }
+
+        static I bits(F v) {
+            I i;
+            std::memcpy(&i, &v, sizeof(i));
+            return i;
+        }
+
+        static F from_bits(I i) {
+            F v;
+            std::memcpy(&v, &i, sizeof(v));
+            return v;
+        }
+
+        static I iset(std::uint32_t value) { return value; }
+        static I iand(I a, I b) { return a & b; }
+        static I ior(I a, I b) { return a | b; }
+        static I ixor(I a, I b) { return a ^ b; }
+        static I iandnot(I a, I b) { return ~a & b; }
+        static I iadd(I a, I b) { return a + b; }
+        static I isub(I a, I b) { return a - b; }
+        template<int N> static I ishl(I a) { return a << N; }
+    };
+
+#if defined(KEX_SIMD_SSE2)
+    struct SimdOps {
+        static constexpr int width = 4;
+        using F = __m128;
+        using I = __m128i;
+
+        static F load(const float *values) { return _mm_loadu_ps(values); }
+        static void store(float *values, F v) { _mm_storeu_ps(values, v); }
+        static F set(float value) { return _mm_set1_ps(value); }
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static I bits(F v) { return _mm_castps_si128(v); }
+        static F from_bits(I i) { return _mm_castsi128_ps(i); }
+        static I iset(std::uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+        static I iand(I a, I b) { return _mm_and_si128(a, b); }
+        static I ior(I a, I b) { return _mm_or_si128(a, b); }
+        static I ixor(I a, I b) { return _mm_xor_si128(a, b); }
+        static I iandnot(I a, I b) { return _mm_andnot_si128(a, b); }
+        static I iadd(I a, I b) { return _mm_add_epi32(a, b); }
+        static I isub(I a, I b) { return _mm_sub_epi32(a, b); }
+        template<int N> static I ishl(I a) { return _mm_slli_epi32(a, N); }
+    };
+#elif defined(KEX_SIMD_NEON)
+    struct SimdOps {
+        static constexpr int width = 4;
+        using F = float32x4_t;
+        using I = uint32x4_t;
+
+        static F load(const float *values) { return vld1q_f32(values); }
+        static void store(float *values, F v) { vst1q_f32(values, v); }
+        static F set(float value) { return vdupq_n_f32(value); }
+        static F add(F a, F b) { return vaddq_f32(a, b); }
+        static F sub(F a, F b) { return vsubq_f32(a, b); }
+        static F mul(F a, F b) { return vmulq_f32(a, b); }
+        static I bits(F v) { return vreinterpretq_u32_f32(v); }
+        static F from_bits(I i) { return vreinterpretq_f32_u32(i); }
+        static I iset(std::uint32_t value) { return vdupq_n_u32(value); }
+        static I iand(I a, I b) { return vandq_u32(a, b); }
+        static I ior(I a, I b) { return vorrq_u32(a, b); }
+        static I ixor(I a, I b) { return veorq_u32(a, b); }
+        static I iandnot(I a, I b) { return vbicq_u32(b, a); }
+        static I iadd(I a, I b) { return vaddq_u32(a, b); }
+        static I isub(I a, I b) { return vsubq_u32(a, b); }
+        template<int N> static I ishl(I a) { return vshlq_n_u32(a, N); }
+    };
+#elif defined(KEX_SIMD_WASM)
+    struct SimdOps {
+        static constexpr int width = 4;
+        using F = v128_t;
+        using I = v128_t;
+
+        static F load(const float *values) { return wasm_v128_load(values); }
+        static void store(float *values, F v) { wasm_v128_store(values, v); }
+        static F set(float value) { return wasm_f32x4_splat(value); }
+        static F add(F a, F b) { return wasm_f32x4_add(a, b); }
+        static F sub(F a, F b) { return wasm_f32x4_sub(a, b); }
+        static F mul(F a, F b) { return wasm_f32x4_mul(a, b); }
+        static I bits(F v) { return v; }
+        static F from_bits(I i) { return i; }
+        static I iset(std::uint32_t value) { return wasm_u32x4_splat(value); }
+        static I iand(I a, I b) { return wasm_v128_and(a, b); }
+        static I ior(I a, I b) { return wasm_v128_or(a, b); }
+        static I ixor(I a, I b) { return wasm_v128_xor(a, b); }
+        static I iandnot(I a, I b) { return wasm_v128_andnot(b, a); }
+        static I iadd(I a, I b) { return wasm_i32x4_add(a, b); }
+        static I isub(I a, I b) { return wasm_i32x4_sub(a, b); }
+        template<int N> static I ishl(I a) { return wasm_i32x4_shl(a, N); }
+    };
+#else
+    using SimdOps = ScalarOps;
+#endif
+
+    /**
+     * Compute the sine and cosine of the angles.
+     *
+     * The angle is reduced to [-pi/4, pi/4] around the nearest multiple of pi/2 (in three steps to retain precision),
+     * then both functions are approximated by minimax polynomials and reassembled based on the quadrant. Accurate
+     * to a few ULPs for angles up to several thousand radians.
+     */
+    template<typename Ops>
+    static inline void sincos(typename Ops::F angle, typename Ops::F &sin, typename Ops::F &cos) {
+        using F = typename Ops::F;
+        using I = typename Ops::I;
+
+        // Adding 1.5 * 2^23 rounds to the nearest integer, which ends up in the low bits of the mantissa
+        const F rounding = Ops::set(12582912.f);
+        const F rounded = Ops::add(Ops::mul(angle, Ops::set(0.63661977236f)), rounding);
+        const I quadrant = Ops::bits(rounded);
+        const F multiple = Ops::sub(rounded, rounding);
+
+        F x = Ops::sub(angle, Ops::mul(multiple, Ops::set(1.5703125f)));
+        x = Ops::sub(x, Ops::mul(multiple, Ops::set(4.837512969970703125e-4f)));
+        x = Ops::sub(x, Ops::mul(multiple, Ops::set(7.54978995489188216e-8f)));
+
+        const F x2 = Ops::mul(x, x);
+        F sin_x = Ops::add(Ops::mul(x2, Ops::set(-1.9515295891e-4f)), Ops::set(8.3321608736e-3f));
+        sin_x = Ops::add(Ops::mul(sin_x, x2), Ops::set(-1.6666654611e-1f));
+        sin_x = Ops::add(Ops::mul(Ops::mul(sin_x, x2), x), x);
+        F cos_x = Ops::add(Ops::mul(x2, Ops::set(2.443315711809948e-5f)), Ops::set(-1.388731625493765e-3f));
+        cos_x = Ops::add(Ops::mul(cos_x, x2), Ops::set(4.166664568298827e-2f));
+        cos_x = Ops::add(Ops::mul(Ops::mul(cos_x, x2), x2), Ops::sub(Ops::set(1.f), Ops::mul(x2, Ops::set(0.5f))));
+
+        // Odd quadrants swap the functions, the second bit of the quadrant (shifted by one for cosine) flips the sign
+        const I one = Ops::iset(1);
+        const I two = Ops::iset(2);
+        const I swap = Ops::isub(Ops::iset(0), Ops::iand(quadrant, one));
+        const I sin_bits = Ops::bits(sin_x);
+        const I cos_bits = Ops::bits(cos_x);
+        const I sin_sign = Ops::template ishl<30>(Ops::iand(quadrant, two));
+        const I cos_sign = Ops::template ishl<30>(Ops::iand(Ops::iadd(quadrant, one), two));
+        sin = Ops::from_bits(Ops::ixor(Ops::ior(Ops::iand(swap, cos_bits), Ops::iandnot(swap, sin_bits)), sin_sign));
+        cos = Ops::from_bits(Ops::ixor(Ops::ior(Ops::iand(swap, sin_bits), Ops::iandnot(swap, cos_bits)), cos_sign));
+    }
+
+}
+
+#endif //KEX_SPRITESIMD_HPP
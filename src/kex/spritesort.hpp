@@ -0,0 +1,126 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_SPRITESORT_HPP
+#define KEX_SPRITESORT_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <kex/texture.hpp>
+
+namespace kex {
+
+    /**
+     * Programs used to render sprites.
+     */
+    enum SpriteProgram {
+        TEXTURE,
+        TEXTURE_ARRAY,
+    };
+
+    /**
+     * Sort key of a sprite within a batch.
+     *
+     * From the most to the least significant bits:
+     *     - layer (16 bits, biased so that negative layers sort first)
+     *     - blend mode (8 bits)
+     *     - program (8 bits)
+     *     - texture handle (32 bits)
+     *
+     * Kex currently uses a single blend mode for sprites, so the blend mode is always zero.
+     */
+    using SpriteSortKey = std::uint64_t;
+
+    static constexpr int SORT_KEY_LAYER_SHIFT = 48;
+    static constexpr int SORT_KEY_PROGRAM_SHIFT = 32;
+    static constexpr SpriteSortKey SORT_KEY_STATE_MASK = (SpriteSortKey{1} << SORT_KEY_LAYER_SHIFT) - 1;
+
+    static inline SpriteSortKey make_sort_key(int layer, SpriteProgram program, TextureHandle texture) {
+        const auto biased_layer = static_cast<std::uint16_t>(layer - std::numeric_limits<std::int16_t>::min());
+        return static_cast<SpriteSortKey>(biased_layer) << SORT_KEY_LAYER_SHIFT |
+               static_cast<SpriteSortKey>(program) << SORT_KEY_PROGRAM_SHIFT |
+               texture;
+    }
+
+    /**
+     * Make sure that a layer fits into its bits of the sort key instead of wrapping into another layer.
+     */
+    static inline void check_layer(int layer) {
+        if (layer < std::numeric_limits<std::int16_t>::min() || layer > std::numeric_limits<std::int16_t>::max()) {
+            throw std::out_of_range("Sprite layer " + std::to_string(layer) + " is outside of [-32768, 32767]");
+        }
+    }
+
+    static inline SpriteProgram sort_key_program(SpriteSortKey key) {
+        return static_cast<SpriteProgram>((key >> SORT_KEY_PROGRAM_SHIFT) & 0xFF);
+    }
+
+    static inline TextureHandle sort_key_texture(SpriteSortKey key) {
+        return static_cast<TextureHandle>(key & 0xFFFFFFFF);
+    }
+
+    struct SpriteSortEntry {
+        SpriteSortKey key;
+        std::uint32_t index;
+    };
+
+    /**
+     * Stable LSD radix sort of the entries by their keys, 8 bits per pass.
+     *
+     * Passes in which all keys share the same byte are skipped, so the usual case of few layers and textures
+     * only costs a couple of passes.
+     */
+    static inline void radix_sort(std::vector<SpriteSortEntry> &entries, std::vector<SpriteSortEntry> &scratch) {
+        constexpr int passes = sizeof(SpriteSortKey);
+        const auto n = entries.size();
+        if (n < 2) return;
+
+        std::array<std::array<std::uint32_t, 256>, passes> histograms{};
+        for (const auto &entry: entries) {
+            for (int pass = 0; pass < passes; ++pass) {
+                ++histograms[pass][(entry.key >> (8 * pass)) & 0xFF];
+            }
+        }
+
+        scratch.resize(n);
+        for (int pass = 0; pass < passes; ++pass) {
+            auto &histogram = histograms[pass];
+            const int shift = 8 * pass;
+            if (histogram[(entries[0].key >> shift) & 0xFF] == n) continue;
+
+            std::uint32_t offset = 0;
+            for (auto &count: histogram) {
+                const auto bucket_count = count;
+                count = offset;
+                offset += bucket_count;
+            }
+
+            for (const auto &entry: entries) {
+                scratch[histogram[(entry.key >> shift) & 0xFF]++] = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+
+}
+
+#endif //KEX_SPRITESORT_HPP
@@ -0,0 +1,109 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_SPRITETRANSFORM_HPP
+#define KEX_SPRITETRANSFORM_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <kex/sprite.hpp>
+
+namespace kex {
+
+    /**
+     * Linear part of the transform of a sprite, i.e. the first two columns without their last row.
+     *
+     * Same matrix as Sprite::transform().
+     */
+    static inline std::array<float, 2 * 2> sprite_linear(float w_scaled, float h_scaled, float rotation,
+                                                         float shear_x, float shear_y) {
+        if (rotation == 0.f) {
+            // Axis-aligned
+            return {w_scaled, shear_y, shear_x, h_scaled};
+        }
+
+        // Negative to keep CCW rotation direction since y-axis points down in the pixel coordinate system
+        const auto cos = std::cos(-rotation);
+        const auto sin = std::sin(-rotation);
+        return {
+                w_scaled * cos + shear_x * sin, shear_y * cos + h_scaled * sin,
+                -w_scaled * sin + shear_x * cos, -shear_y * sin + h_scaled * cos,
+        };
+    }
+
+    /**
+     * Cache of the transforms of the sprites added to a recording, addressed by the order in which they are added.
+     *
+     * Sprites are plain values without an identity, but a retained batch usually adds the same sprites in the same
+     * order every frame. Each sprite is therefore compared with the sprite added at the same position in the previous
+     * frame: when its size, rotation, scale and shear are unchanged, only its translation is copied and the linear
+     * part is reused.
+     */
+    class SpriteTransformCache {
+    public:
+        /** Start over with the first sprite, keeping the cached entries. */
+        void rewind() { next = 0; }
+
+        /**
+         * Transform of the next added sprite without the constant last row of each column.
+         *
+         * @param sprite Sprite to transform
+         * @param rectangle Region of the texture used by the sprite
+         */
+        std::array<float, 3 * 2> transform(const Sprite &sprite, const RectangleDef &rectangle) {
+            if (next == entries.size()) {
+                entries.emplace_back();
+            }
+            auto &entry = entries[next++];
+
+            const auto w_scaled = static_cast<float>(rectangle.w) * sprite.scale_x;
+            const auto h_scaled = static_cast<float>(rectangle.h) * sprite.scale_y;
+            if (w_scaled != entry.w_scaled || h_scaled != entry.h_scaled || sprite.rotation != entry.rotation ||
+                sprite.shear_x != entry.shear_x || sprite.shear_y != entry.shear_y) {
+                entry.w_scaled = w_scaled;
+                entry.h_scaled = h_scaled;
+                entry.rotation = sprite.rotation;
+                entry.shear_x = sprite.shear_x;
+                entry.shear_y = sprite.shear_y;
+                entry.linear = sprite_linear(w_scaled, h_scaled, sprite.rotation, sprite.shear_x, sprite.shear_y);
+            }
+
+            const auto &linear = entry.linear;
+            return {linear[0], linear[1], linear[2], linear[3], sprite.x, sprite.y};
+        }
+
+    private:
+        struct Entry {
+            // NaN never compares equal, so the first transform is always computed
+            float w_scaled = std::numeric_limits<float>::quiet_NaN();
+            float h_scaled = 0.f;
+            float rotation = 0.f;
+            float shear_x = 0.f, shear_y = 0.f;
+            std::array<float, 2 * 2> linear{};
+        };
+
+        std::vector<Entry> entries;
+        std::size_t next = 0;
+    };
+
+}
+
+#endif //KEX_SPRITETRANSFORM_HPP
@@ -0,0 +1,238 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <kex/state.hpp>
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+#include <glad/gles2.h>
+
+namespace kex {
+
+    /** Value of a cached binding that is not known, so that the next change always reaches OpenGL. */
+    static constexpr GLuint UNKNOWN = ~GLuint{0};
+
+    /** Number of texture units whose bindings are cached. */
+    static constexpr int CACHED_TEXTURE_UNITS = 32;
+
+    static constexpr std::array<GLenum, 4> buffer_targets = {
+            GL_ARRAY_BUFFER,
+            GL_ELEMENT_ARRAY_BUFFER,
+            GL_PIXEL_PACK_BUFFER,
+            GL_PIXEL_UNPACK_BUFFER,
+    };
+
+    static constexpr std::array<GLenum, 2> texture_targets = {
+            GL_TEXTURE_2D,
+            GL_TEXTURE_2D_ARRAY,
+    };
+
+    struct State {
+        GLuint program = UNKNOWN;
+        GLuint vertex_array = UNKNOWN;
+        std::array<GLuint, buffer_targets.size()> buffers{};
+        GLuint active_texture_unit = UNKNOWN;
+        std::array<std::array<GLuint, texture_targets.size()>, CACHED_TEXTURE_UNITS> textures{};
+        int blend = -1;
+        GLenum blend_source_factor = UNKNOWN;
+        GLenum blend_destination_factor = UNKNOWN;
+
+        // Uniform values of each program, keyed by the program and the uniform location
+        std::unordered_map<std::uint64_t, int> uniforms;
+
+        unsigned long long skipped_calls = 0;
+
+        State() {
+            invalidate();
+        }
+
+        void invalidate() {
+            program = UNKNOWN;
+            vertex_array = UNKNOWN;
+            buffers.fill(UNKNOWN);
+            active_texture_unit = UNKNOWN;
+            for (auto &unit: textures) unit.fill(UNKNOWN);
+            blend = -1;
+            blend_source_factor = UNKNOWN;
+            blend_destination_factor = UNKNOWN;
+            uniforms.clear();
+        }
+    };
+
+    static State state;
+
+    template<std::size_t N>
+    static inline int target_index(const std::array<GLenum, N> &targets, GLenum target) {
+        for (std::size_t i = 0; i < N; ++i) {
+            if (targets[i] == target) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    static inline std::uint64_t uniform_key(GLuint program, int location) {
+        return static_cast<std::uint64_t>(program) << 32 | static_cast<std::uint32_t>(location);
+    }
+
+    void StateCache::invalidate() { state.invalidate(); }
+
+    unsigned long long StateCache::skipped_calls() { return state.skipped_calls; }
+
+    void StateCache::reset_skipped_calls() { state.skipped_calls = 0; }
+
+    void StateCache::use_program(unsigned int id) {
+        if (state.program == id) {
+            ++state.skipped_calls;
+            return;
+        }
+
+        glUseProgram(id);
+        state.program = id;
+    }
+
+    void StateCache::bind_vertex_array(unsigned int id) {
+        if (state.vertex_array == id) {
+            ++state.skipped_calls;
+            return;
+        }
+
+        glBindVertexArray(id);
+        state.vertex_array = id;
+
+        // The element array buffer binding is part of the vertex array state
+        state.buffers[target_index(buffer_targets, GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    }
+
+    void StateCache::bind_buffer(unsigned int target, unsigned int id) {
+        const auto index = target_index(buffer_targets, target);
+        if (index != -1 && state.buffers[index] == id) {
+            ++state.skipped_calls;
+            return;
+        }
+
+        glBindBuffer(target, id);
+        if (index != -1) state.buffers[index] = id;
+    }
+
+    bool StateCache::is_buffer_bound(unsigned int target, unsigned int id) {
+        const auto index = target_index(buffer_targets, target);
+        return index != -1 && state.buffers[index] == id;
+    }
+
+    void StateCache::bind_texture(unsigned int target, unsigned int id, unsigned int unit) {
+        const auto index = target_index(texture_targets, target);
+        const bool cached = index != -1 && unit < CACHED_TEXTURE_UNITS;
+        if (cached && state.textures[unit][index] == id) {
+            ++state.skipped_calls;
+            return;
+        }
+
+        active_texture(unit);
+        glBindTexture(target, id);
+        if (cached) state.textures[unit][index] = id;
+    }
+
+    void StateCache::active_texture(unsigned int unit) {
+        if (state.active_texture_unit == unit) {
+            ++state.skipped_calls;
+            return;
+        }
+
+        glActiveTexture(GL_TEXTURE0 + unit);
+        state.active_texture_unit = unit;
+    }
+
+    void StateCache::set_uniform(int location, int value) {
+        if (location == -1 || state.program == UNKNOWN) {
+            glUniform1i(location, value);
+            return;
+        }
+
+        const auto [it, inserted] = state.uniforms.try_emplace(uniform_key(state.program, location), value);
+        if (!inserted) {
+            if (it->second == value) {
+                ++state.skipped_calls;
+                return;
+            }
+            it->second = value;
+        }
+
+        glUniform1i(location, value);
+    }
+
+    void StateCache::set_blend(bool enabled) {
+        if (state.blend == static_cast<int>(enabled)) {
+            ++state.skipped_calls;
+            return;
+        }
+
+        if (enabled) {
+            glEnable(GL_BLEND);
+        } else {
+            glDisable(GL_BLEND);
+        }
+        state.blend = enabled;
+    }
+
+    void StateCache::set_blend_func(unsigned int source_factor, unsigned int destination_factor) {
+        if (state.blend_source_factor == source_factor && state.blend_destination_factor == destination_factor) {
+            ++state.skipped_calls;
+            return;
+        }
+
+        glBlendFunc(source_factor, destination_factor);
+        state.blend_source_factor = source_factor;
+        state.blend_destination_factor = destination_factor;
+    }
+
+    void StateCache::forget_program(unsigned int id) {
+        // A deleted program stays in use until another one is installed
+        if (state.program == id) state.program = UNKNOWN;
+
+        for (auto it = state.uniforms.begin(); it != state.uniforms.end();) {
+            if (it->first >> 32 == id) {
+                it = state.uniforms.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void StateCache::forget_vertex_array(unsigned int id) {
+        // Deleting a bound vertex array reverts the binding to zero
+        if (state.vertex_array == id) state.vertex_array = 0;
+    }
+
+    void StateCache::forget_buffer(unsigned int id) {
+        // Deleting a bound buffer reverts the binding to zero
+        for (auto &bound_id: state.buffers) {
+            if (bound_id == id) bound_id = 0;
+        }
+    }
+
+    void StateCache::forget_texture(unsigned int id) {
+        // Deleting a bound texture reverts the binding to zero
+        for (auto &unit: state.textures) {
+            for (auto &bound_id: unit) {
+                if (bound_id == id) bound_id = 0;
+            }
+        }
+    }
+
+}
@@ -16,8 +16,13 @@ You should have received a copy of the GNU Lesser General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <memory>
 #include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 
 #include <glad/gles2.h>
 
@@ -25,73 +30,488 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <stb_image.h>
 
 #include <kex/texture.hpp>
+#include <kex/state.hpp>
+#include <kex/ringbuffer.hpp>
+
+#include "textureregistry.hpp"
+#include "atlasfile.hpp"
+#include "ktxfile.hpp"
 
 namespace kex {
 
+    using ImageData = std::unique_ptr<unsigned char, decltype(&stbi_image_free)>;
+
+    static ImageData load_image(const std::string &path, int &width, int &height) {
+        if (!std::filesystem::exists(path)) {
+            throw std::runtime_error(path + " does not exist.");
+        }
+
+        // Rows are flipped later, while copying them into a pixel unpack buffer
+        int n_original_channels;
+        stbi_set_flip_vertically_on_load(false);
+        unsigned char *data = stbi_load(path.c_str(), &width, &height, &n_original_channels, 4);
+        if (data == nullptr) {
+            throw std::runtime_error("Could not load texture from " + path);
+        }
+        return {data, stbi_image_free};
+    }
+
+    /** Replace rows of the base level of the bound texture, or of one layer of the bound texture array. */
+    static void upload_rows(GLenum target, int layer, int y, int width, int height, const void *rows) {
+        if (target == GL_TEXTURE_2D_ARRAY) {
+            glTexSubImage3D(target, 0, 0, y, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+        } else {
+            glTexSubImage2D(target, 0, 0, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+        }
+    }
+
+#ifndef __EMSCRIPTEN__
+    /** Size of each region of the staging ring buffer in bytes. */
+    static constexpr int STAGING_REGION_SIZE = 2 * 1024 * 1024;
+
+    /**
+     * Ring of pixel unpack buffers shared by all synchronous uploads.
+     *
+     * It is created with the first upload and never destroyed, since the OpenGL context may be gone by the time
+     * static objects are destroyed.
+     */
+    static PixelUnpackRingBuffer &staging_buffer() {
+        static auto *staging = new PixelUnpackRingBuffer(STAGING_REGION_SIZE);
+        return *staging;
+    }
+#endif
+
+    /**
+     * Upload RGBA pixels, starting with the top row, into the bound texture.
+     *
+     * The rows are flipped into the bottom-up order expected by OpenGL while they are copied into the staging ring
+     * buffer, from which the driver can then transfer them asynchronously. Images larger than a region of the ring are
+     * uploaded in bands of rows, so the ring does not grow with the largest texture. WebGL 2 cannot map buffers, so
+     * there the rows are flipped into client memory and uploaded from it.
+     */
+    static void upload_pixels(GLenum target, int layer, int width, int height, const unsigned char *pixels) {
+        const auto row_size = static_cast<std::size_t>(width) * 4;
+#ifdef __EMSCRIPTEN__
+        static std::vector<unsigned char> flipped;
+        flipped.resize(row_size * height);
+        for (int row = 0; row < height; ++row) {
+            std::memcpy(flipped.data() + row_size * (height - 1 - row), pixels + row_size * row, row_size);
+        }
+        upload_rows(target, layer, 0, width, height, flipped.data());
+#else
+        auto &staging = staging_buffer();
+        const auto band = std::max(1, static_cast<int>(STAGING_REGION_SIZE / row_size));
+        for (int y = 0; y < height; y += band) {
+            const auto rows = std::min(band, height - y);
+            int offset;
+            auto *mapped = static_cast<unsigned char *>(staging.map(static_cast<int>(row_size) * rows, offset));
+            if (mapped == nullptr) {
+                staging.buffer().unbind();
+                throw std::runtime_error("Could not map a pixel unpack buffer.");
+            }
+            for (int row = 0; row < rows; ++row) {
+                // Row y + row counts from the bottom, whereas the rows of the pixels count from the top
+                std::memcpy(mapped + row_size * row, pixels + row_size * (height - 1 - y - row), row_size);
+            }
+            staging.unmap();
+
+            // Pixels are read from the bound buffer, starting at the offset of the mapped range
+            const auto *source = reinterpret_cast<const void *>(static_cast<std::intptr_t>(offset));
+            upload_rows(target, layer, y, width, rows, source);
+        }
+
+        // Client memory is expected again by other uploads
+        staging.buffer().unbind();
+#endif
+    }
+
+    /** Number of bytes of RGBA pixels with 8 bits per channel, including the mipmap if there is one. */
+    static std::size_t rgba_bytes(int width, int height, bool mipmap) {
+        std::size_t bytes = 0;
+        for (std::uint32_t level = 0;; ++level) {
+            const auto level_width = level_size(static_cast<std::uint32_t>(width), level);
+            const auto level_height = level_size(static_cast<std::uint32_t>(height), level);
+            bytes += static_cast<std::size_t>(level_width) * level_height * 4;
+            if (!mipmap || (level_width == 1 && level_height == 1)) return bytes;
+        }
+    }
+
     class Texture::Impl {
     public:
-        explicit Impl(const std::string &path, const bool mipmap) {
-            if (!std::filesystem::exists(path)) {
-                throw std::runtime_error(path + " does not exist.");
+        explicit Impl(const std::string &path, const bool mipmap) : source_path(path), source_mipmap(mipmap) {
+            try {
+                load();
+            } catch (...) {
+                // The destructor does not run for a partially constructed texture
+                release();
+                throw;
+            }
+        }
+
+        explicit Impl(const unsigned char *pixels, int width, int height, const bool mipmap) : width(width),
+                                                                                               height(height) {
+            if (width <= 0 || height <= 0) {
+                throw std::invalid_argument("Texture dimensions must be positive.");
+            }
+            try {
+                upload(pixels, mipmap);
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+
+        explicit Impl(const std::string &path, int width, int height, const bool mipmap) : width(width),
+                                                                                           height(height),
+                                                                                           source_path(path),
+                                                                                           source_mipmap(mipmap) {
+            // A single transparent pixel stands in until the actual pixels are uploaded
+            create(mipmap);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, TRANSPARENT);
+            bytes = rgba_bytes(1, 1, false);
+            StateCache::bind_texture(GL_TEXTURE_2D, 0); // Unbind
+        }
+
+        /** Load the texture from its source file. */
+        void load() {
+            if (AtlasFile::is_atlas_file(source_path)) {
+                upload(AtlasFile(source_path), source_mipmap);
+                return;
+            }
+            if (KtxFile::is_ktx_file(source_path)) {
+                upload(KtxFile(source_path));
+                return;
             }
 
             // Load the image
-            int n_original_channels;
-            stbi_set_flip_vertically_on_load(true);
-            unsigned char *data = stbi_load(path.c_str(), &width, &height, &n_original_channels, 4);
-            if (data == nullptr) {
-                throw std::runtime_error("Could not load texture from " + path);
+            const auto data = load_image(source_path, width, height);
+            upload(data.get(), source_mipmap);
+        }
+
+        /**
+         * Release the video memory of the texture while keeping its identifier, which leaves a transparent pixel.
+         */
+        void evict() {
+            StateCache::active_texture(0);
+            StateCache::bind_texture(GL_TEXTURE_2D, id);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, TRANSPARENT);
+
+            // Mip levels are released by giving them no pixels
+            for (std::uint32_t level = 1; level_size(static_cast<std::uint32_t>(width), level - 1) > 1 ||
+                                          level_size(static_cast<std::uint32_t>(height), level - 1) > 1; ++level) {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                             nullptr);
             }
+            StateCache::bind_texture(GL_TEXTURE_2D, 0); // Unbind
+        }
 
-            // Generate an OpenGL texture
-            glGenTextures(1, &id);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, id);
+        /**
+         * Replace the pixels of the texture with rows in the bottom-up order of OpenGL, which are read from the
+         * bound pixel unpack buffer if there is one.
+         */
+        void replace_rows(const void *rows, int new_width, int new_height, const bool mipmap) {
+            width = new_width;
+            height = new_height;
+            top_down = false;
+            create(mipmap);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+            if (mipmap) {
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+            bytes = rgba_bytes(width, height, mipmap);
+            StateCache::bind_texture(GL_TEXTURE_2D, 0); // Unbind
+        }
+
+        void bind(unsigned int unit) const {
+            Texture::bind(id, unit);
+        }
+
+        ~Impl() { release(); }
+
+    private:
+        GLuint id = 0;
+        int width = 0;
+        int height = 0;
+        bool top_down = false;
+        TextureHandle handle = 0;
+
+        /** File the texture is loaded from, or empty if it was created from memory. */
+        std::string source_path;
+        bool source_mipmap = false;
+
+        /** Size of the texture in video memory. */
+        std::size_t bytes = 0;
+
+        static constexpr unsigned char TRANSPARENT[4] = {0, 0, 0, 0};
+
+        /** Delete the OpenGL texture, if it was generated. */
+        void release() {
+            if (id == 0) return;
+            glDeleteTextures(1, &id);
+            StateCache::forget_texture(id);
+        }
+
+        /** Generate an OpenGL texture, or reuse the existing one when reloading, and leave it bound. */
+        void create(const bool mipmap) {
+            const auto reused = id != 0;
+            if (!reused) {
+                glGenTextures(1, &id);
+            }
+            StateCache::active_texture(0);
+            StateCache::bind_texture(GL_TEXTURE_2D, id);
+            if (reused) {
+                // Eviction limits the texture to its base level
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+            }
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        }
+
+        void upload(const unsigned char *data, const bool mipmap) {
+            top_down = false;
+            create(mipmap);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            upload_pixels(GL_TEXTURE_2D, 0, width, height, data);
             if (mipmap) {
                 glGenerateMipmap(GL_TEXTURE_2D);
             }
+            bytes = rgba_bytes(width, height, mipmap);
 
-            glBindTexture(GL_TEXTURE_2D, 0); // Unbind
-            stbi_image_free(data); // Free image data from RAM
+            StateCache::bind_texture(GL_TEXTURE_2D, 0); // Unbind
         }
 
-        void bind() const {
-            Texture::bind(id);
+        void upload(const AtlasFile &file, const bool mipmap) {
+            const auto &header = file.header();
+            width = static_cast<int>(header.width);
+            height = static_cast<int>(header.height);
+            top_down = false;
+            const auto has_mipmap = header.levels > 1;
+            create(mipmap || has_mipmap);
+
+            // Levels are uploaded straight from the mapped file
+            for (std::uint32_t level = 0; level < header.levels; ++level) {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA,
+                             static_cast<GLsizei>(level_size(header.width, level)),
+                             static_cast<GLsizei>(level_size(header.height, level)), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                             file.level(level));
+            }
+            if (has_mipmap) {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(header.levels - 1));
+                bytes = 0;
+                for (std::uint32_t level = 0; level < header.levels; ++level) {
+                    bytes += rgba_bytes(static_cast<int>(level_size(header.width, level)),
+                                        static_cast<int>(level_size(header.height, level)), false);
+                }
+            } else {
+                if (mipmap) {
+                    glGenerateMipmap(GL_TEXTURE_2D);
+                }
+                bytes = rgba_bytes(width, height, mipmap);
+            }
+
+            StateCache::bind_texture(GL_TEXTURE_2D, 0); // Unbind
+        }
+
+        void upload(const KtxFile &file) {
+            width = file.width();
+            height = file.height();
+            top_down = file.is_top_down();
+            const auto &levels = file.mip_levels();
+            const auto has_mipmap = levels.size() > 1;
+
+            // Compressed blocks are uploaded straight from the mapped file, including all stored mip levels
+            create(has_mipmap);
+            bytes = 0;
+            for (std::size_t level = 0; level < levels.size(); ++level) {
+                const auto &[level_width, level_height, data, size] = levels[level];
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), file.internal_format(), level_width,
+                                       level_height, 0, static_cast<GLsizei>(size), data);
+                bytes += size;
+            }
+            if (has_mipmap) {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size() - 1));
+            }
+
+            StateCache::bind_texture(GL_TEXTURE_2D, 0); // Unbind
+        }
+
+        friend Texture;
+    };
+
+    Texture::Texture(const std::string &path, const bool mipmap) : impl(
+            std::make_unique<Texture::Impl>(path, mipmap)) {
+        impl->handle = TextureRegistry::add(*this);
+        TextureRegistry::track(impl->handle, impl->bytes, true);
+    }
+
+    Texture::Texture(const unsigned char *pixels, int width, int height, const bool mipmap) : impl(
+            std::make_unique<Texture::Impl>(pixels, width, height, mipmap)) {
+        impl->handle = TextureRegistry::add(*this);
+        TextureRegistry::track(impl->handle, impl->bytes, false);
+    }
+
+    Texture::Texture(const std::string &path, int width, int height, const bool mipmap) : impl(
+            std::make_unique<Texture::Impl>(path, width, height, mipmap)) {
+        impl->handle = TextureRegistry::add(*this);
+        TextureRegistry::track(impl->handle, impl->bytes, false);
+    }
+
+    void Texture::upload_rows(const void *rows, int width, int height, const bool mipmap) const {
+        const auto previous_width = impl->width;
+        const auto previous_height = impl->height;
+        const auto top_down = impl->top_down;
+        impl->replace_rows(rows, width, height, mipmap);
+        uploaded(previous_width, previous_height, top_down);
+    }
+
+    void Texture::upload(const AtlasFile &file, const bool mipmap) const {
+        const auto width = impl->width;
+        const auto height = impl->height;
+        const auto top_down = impl->top_down;
+        impl->upload(file, mipmap);
+        uploaded(width, height, top_down);
+    }
+
+    void Texture::upload(const KtxFile &file) const {
+        const auto width = impl->width;
+        const auto height = impl->height;
+        const auto top_down = impl->top_down;
+        impl->upload(file);
+        uploaded(width, height, top_down);
+    }
+
+    void Texture::uploaded(int previous_width, int previous_height, bool previous_top_down) const {
+        if (impl->width != previous_width || impl->height != previous_height || impl->top_down != previous_top_down) {
+            TextureRegistry::resize(impl->handle, impl->width, impl->height, impl->top_down);
+        }
+        TextureRegistry::track(impl->handle, impl->bytes, true);
+    }
+
+    void Texture::evict() const { impl->evict(); }
+
+    void Texture::reload() const {
+        const auto width = impl->width;
+        const auto height = impl->height;
+        const auto top_down = impl->top_down;
+        impl->load();
+        uploaded(width, height, top_down);
+    }
+
+    const std::string &Texture::source_path() const { return impl->source_path; }
+
+    bool Texture::source_mipmap() const { return impl->source_mipmap; }
+
+    void Texture::bind(unsigned int unit) const { impl->bind(unit); }
+
+    int Texture::width() const { return impl->width; }
+
+    int Texture::height() const { return impl->height; }
+
+    unsigned int Texture::id() const { return impl->id; }
+
+    TextureHandle Texture::handle() const { return impl->handle; }
+
+    bool Texture::is_top_down() const { return impl->top_down; }
+
+    void Texture::bind(unsigned int id, unsigned int unit) {
+        StateCache::bind_texture(GL_TEXTURE_2D, id, unit);
+    }
+
+    Texture::~Texture() { TextureRegistry::remove(impl->handle); }
+
+    class TextureArray::Impl {
+    public:
+        explicit Impl(const std::vector<std::string> &paths, const bool mipmap) : layers(
+                static_cast<int>(paths.size())) {
+            if (paths.empty()) {
+                throw std::runtime_error("Texture array requires at least one image.");
+            }
+
+            // Generate an OpenGL texture array
+            glGenTextures(1, &id);
+            StateCache::bind_texture(GL_TEXTURE_2D_ARRAY, id);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            // Load the images layer by layer
+            try {
+                for (int layer = 0; layer < layers; ++layer) {
+                    const auto &path = paths[layer];
+                    int layer_width, layer_height;
+                    const auto data = load_image(path, layer_width, layer_height);
+                    if (layer == 0) {
+                        width = layer_width;
+                        height = layer_height;
+                        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, width, height, layers, 0, GL_RGBA,
+                                     GL_UNSIGNED_BYTE, nullptr);
+                    } else if (layer_width != width || layer_height != height) {
+                        throw std::runtime_error(path + " does not match the dimensions of the texture array.");
+                    }
+
+                    upload_pixels(GL_TEXTURE_2D_ARRAY, layer, width, height, data.get());
+                }
+            } catch (...) {
+                // The destructor does not run for a partially constructed texture array
+                glDeleteTextures(1, &id);
+                StateCache::forget_texture(id);
+                throw;
+            }
+
+            if (mipmap) {
+                glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            }
+            bytes = rgba_bytes(width, height, mipmap) * static_cast<std::size_t>(layers);
+
+            StateCache::bind_texture(GL_TEXTURE_2D_ARRAY, 0); // Unbind
+        }
+
+        void bind(unsigned int unit) const {
+            TextureArray::bind(id, unit);
         }
 
         ~Impl() {
             glDeleteTextures(1, &id);
+            StateCache::forget_texture(id);
         }
 
     private:
         GLuint id = 0;
         int width = 0;
         int height = 0;
+        int layers = 0;
+        std::size_t bytes = 0;
+        TextureHandle handle = 0;
 
-        friend Texture;
+        friend TextureArray;
     };
 
-    Texture::Texture(const std::string &path, const bool mipmap) : impl(
-            std::make_unique<Texture::Impl>(path, mipmap)) {}
+    TextureArray::TextureArray(const std::vector<std::string> &paths, const bool mipmap) : impl(
+            std::make_unique<TextureArray::Impl>(paths, mipmap)) {
+        impl->handle = TextureRegistry::add(*this);
+        TextureRegistry::track(impl->handle, impl->bytes, false);
+    }
 
-    void Texture::bind() const { impl->bind(); }
+    void TextureArray::bind(unsigned int unit) const { impl->bind(unit); }
 
-    int Texture::width() const { return impl->width; }
+    int TextureArray::width() const { return impl->width; }
 
-    int Texture::height() const { return impl->height; }
+    int TextureArray::height() const { return impl->height; }
 
-    unsigned int Texture::id() const { return impl->id; }
+    int TextureArray::layers() const { return impl->layers; }
+
+    unsigned int TextureArray::id() const { return impl->id; }
+
+    TextureHandle TextureArray::handle() const { return impl->handle; }
 
-    void Texture::bind(unsigned int id) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, id);
+    void TextureArray::bind(unsigned int id, unsigned int unit) {
+        StateCache::bind_texture(GL_TEXTURE_2D_ARRAY, id, unit);
     }
 
-    Texture::~Texture() = default;
+    TextureArray::~TextureArray() { TextureRegistry::remove(impl->handle); }
 
 } // kex
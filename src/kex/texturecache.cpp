@@ -0,0 +1,37 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <kex/texturecache.hpp>
+
+#include "textureregistry.hpp"
+
+namespace kex {
+
+    void TextureCache::set_budget(std::size_t bytes) { TextureRegistry::set_budget(bytes); }
+
+    void TextureCache::next_frame() { TextureRegistry::next_frame(); }
+
+    std::size_t TextureCache::budget() { return TextureRegistry::budget(); }
+
+    std::size_t TextureCache::resident_bytes() { return TextureRegistry::resident_bytes(); }
+
+    std::size_t TextureCache::evictions() { return TextureRegistry::evictions(); }
+
+    std::size_t TextureCache::reloads() { return TextureRegistry::reloads(); }
+
+}
@@ -0,0 +1,391 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <kex/textureloader.hpp>
+#include <kex/buffer.hpp>
+
+#include <stb_image.h>
+
+#include "atlasfile.hpp"
+#include "ktxfile.hpp"
+#include "textureregistry.hpp"
+
+namespace kex {
+
+    using ImageData = std::unique_ptr<unsigned char, decltype(&stbi_image_free)>;
+
+    class TextureLoader::Impl {
+    public:
+        explicit Impl(unsigned int threads) {
+            if (threads == 0) {
+                // hardware_concurrency() is 0 when it is unknown
+                threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+            }
+
+            // Two images per worker keep the workers busy while the previous images are uploaded
+            staging_limit = 2 * threads;
+            for (unsigned int i = 0; i < threads; ++i) {
+                workers.emplace_back(&Impl::work, this);
+            }
+            TextureRegistry::attach_loader();
+        }
+
+        std::shared_ptr<Texture> load(const std::string &path, bool mipmap) {
+            auto job = prepare(path, mipmap);
+
+            // The constructor is private to the loader, which rules out std::make_shared
+            std::shared_ptr<Texture> texture(new Texture(path, job.width, job.height, mipmap));
+            job.texture = texture;
+            enqueue(std::move(job));
+            return texture;
+        }
+
+        std::size_t update(std::chrono::microseconds time_budget, std::size_t byte_budget) {
+            queue_reloads();
+
+            const auto start = std::chrono::steady_clock::now();
+            std::size_t uploaded = 0;
+            std::size_t bytes = 0;
+            while (uploaded == 0 || (bytes < byte_budget && std::chrono::steady_clock::now() - start < time_budget)) {
+                Job result;
+                {
+                    const std::lock_guard lock(mutex);
+                    if (results.empty()) break;
+                    result = std::move(results.front());
+                    results.pop_front();
+                    --in_flight;
+                }
+
+                // Unmapping the staging memory of the result lets its pixels be read by OpenGL
+                const auto staged = result.has_staging();
+                if (staged) {
+                    --staging_count;
+#ifndef __EMSCRIPTEN__
+                    result.staging->unmap();
+#endif
+                }
+
+                // Reloaded textures are not owned by the loader, so their records tell whether they still exist
+                const auto owner = result.texture.lock();
+                const auto *texture = result.reload ? reload_target(result) : owner.get();
+                if (!texture || !result.decoded) {
+                    recycle(result);
+                    stage();
+                    if (!texture) continue;
+                    throw std::runtime_error("Could not load texture from " + result.path);
+                }
+
+                if (result.atlas) {
+                    texture->upload(*result.atlas, result.mipmap);
+                    bytes += atlas_bytes(*result.atlas);
+                } else if (result.ktx) {
+                    texture->upload(*result.ktx);
+                    for (const auto &level: result.ktx->mip_levels()) {
+                        bytes += level.size;
+                    }
+                } else {
+#ifdef __EMSCRIPTEN__
+                    texture->upload_rows(result.staging.data(), result.width, result.height, result.mipmap);
+#else
+                    // Pixels are read from the bound buffer, starting at offset 0
+                    result.staging->bind();
+                    texture->upload_rows(nullptr, result.width, result.height, result.mipmap);
+                    result.staging->unbind();
+#endif
+                    bytes += static_cast<std::size_t>(result.width) * result.height * 4;
+                }
+                recycle(result);
+                ++uploaded;
+            }
+
+            // Staging memory freed by the uploads is handed to waiting images
+            stage();
+            return uploaded;
+        }
+
+        [[nodiscard]] std::size_t pending() const {
+            const std::lock_guard lock(mutex);
+            return in_flight;
+        }
+
+        ~Impl() {
+            TextureRegistry::detach_loader();
+            {
+                const std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            job_available.notify_all();
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        }
+
+    private:
+        /** Texture to load, which carries its staged pixels or its mapped file once a worker is done with it. */
+        struct Job {
+            std::string path;
+            bool mipmap = false;
+            std::weak_ptr<Texture> texture;
+
+            /** Whether an evicted texture is reloaded, which is referred to by its handle instead. */
+            bool reload = false;
+            TextureHandle handle = 0;
+            std::uint32_t serial = 0;
+            std::unique_ptr<AtlasFile> atlas;
+            std::unique_ptr<KtxFile> ktx;
+            int width = 0, height = 0;
+
+            /** Memory the worker writes the rows of the decoded image into, in the bottom-up order of OpenGL. */
+#ifdef __EMSCRIPTEN__
+            // WebGL 2 cannot map buffers, so pixels are uploaded from client memory
+            std::vector<unsigned char> staging;
+#else
+            std::unique_ptr<PixelUnpackBuffer> staging;
+#endif
+            unsigned char *staging_data = nullptr;
+
+            /** Whether the pixels are ready to be uploaded. */
+            bool decoded = false;
+
+            [[nodiscard]] bool has_staging() const { return staging_data != nullptr; }
+
+            /** Whether the texture was destroyed, which only the OpenGL thread can tell for reloaded textures. */
+            [[nodiscard]] bool dropped() const { return !reload && texture.expired(); }
+        };
+
+        mutable std::mutex mutex;
+        std::condition_variable job_available;
+        std::deque<Job> jobs;
+        std::deque<Job> results;
+        std::size_t in_flight = 0;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+
+        /** Images waiting for staging memory, which is only handed out on the OpenGL thread. */
+        std::deque<Job> unstaged;
+        /** Number of images holding staging memory, which is limited to bound the memory of queued images. */
+        std::size_t staging_count = 0;
+        std::size_t staging_limit = 0;
+#ifndef __EMSCRIPTEN__
+        /** Pixel unpack buffers of uploaded images, which are reused rather than created for every image. */
+        std::vector<std::unique_ptr<PixelUnpackBuffer>> free_staging;
+#endif
+
+        static std::size_t atlas_bytes(const AtlasFile &file) {
+            const auto &header = file.header();
+            std::size_t bytes = 0;
+            for (std::uint32_t level = 0; level < header.levels; ++level) {
+                const auto width = level_size(header.width, level);
+                bytes += static_cast<std::size_t>(width) * level_size(header.height, level) * 4;
+            }
+            return bytes;
+        }
+
+        /** Find the size of a texture, validating atlas and KTX files, which maps them without reading their pixels. */
+        static Job prepare(const std::string &path, bool mipmap) {
+            if (!std::filesystem::exists(path)) {
+                throw std::runtime_error(path + " does not exist.");
+            }
+
+            Job job;
+            job.path = path;
+            job.mipmap = mipmap;
+            if (AtlasFile::is_atlas_file(path)) {
+                job.atlas = std::make_unique<AtlasFile>(path);
+                job.width = static_cast<int>(job.atlas->header().width);
+                job.height = static_cast<int>(job.atlas->header().height);
+            } else if (KtxFile::is_ktx_file(path)) {
+                job.ktx = std::make_unique<KtxFile>(path);
+                job.width = job.ktx->width();
+                job.height = job.ktx->height();
+            } else {
+                int n_original_channels;
+                if (stbi_info(path.c_str(), &job.width, &job.height, &n_original_channels) == 0) {
+                    throw std::runtime_error("Could not load texture from " + path);
+                }
+            }
+            return job;
+        }
+
+        /** Texture of a reload, unless it was destroyed or reloaded in the meantime. */
+        static const Texture *reload_target(const Job &job) {
+            const auto &record = TextureRegistry::get(job.handle);
+            if (record.serial != job.serial || record.resident) return nullptr;
+            return record.texture;
+        }
+
+        /** Queue the evicted textures which were drawn since the last update. */
+        void queue_reloads() {
+            TextureHandle handle;
+            while (TextureRegistry::next_reload(handle)) {
+                const auto &record = TextureRegistry::get(handle);
+                auto job = prepare(record.texture->source_path(), record.texture->source_mipmap());
+                job.reload = true;
+                job.handle = handle;
+                job.serial = record.serial;
+                enqueue(std::move(job));
+            }
+        }
+
+        void enqueue(Job job) {
+            {
+                const std::lock_guard lock(mutex);
+                ++in_flight;
+            }
+            if (job.atlas || job.ktx) {
+                submit(std::move(job));
+            } else {
+                unstaged.push_back(std::move(job));
+                stage();
+            }
+        }
+
+        void submit(Job job) {
+            {
+                const std::lock_guard lock(mutex);
+                jobs.push_back(std::move(job));
+            }
+            job_available.notify_one();
+        }
+
+        /** Hand staging memory to waiting images and submit them to the workers. */
+        void stage() {
+            while (!unstaged.empty() && staging_count < staging_limit) {
+                auto job = std::move(unstaged.front());
+                unstaged.pop_front();
+                if (job.dropped() || (job.reload && reload_target(job) == nullptr)) {
+                    const std::lock_guard lock(mutex);
+                    --in_flight;
+                    continue;
+                }
+
+                const auto size = static_cast<std::size_t>(job.width) * job.height * 4;
+#ifdef __EMSCRIPTEN__
+                job.staging.resize(size);
+                job.staging_data = job.staging.data();
+#else
+                if (free_staging.empty()) {
+                    job.staging = std::make_unique<PixelUnpackBuffer>();
+                } else {
+                    job.staging = std::move(free_staging.back());
+                    free_staging.pop_back();
+                }
+
+                // Orphaning hands storage that may still be read by an earlier upload over to the driver
+                job.staging->orphan(static_cast<int>(size));
+                job.staging_data = static_cast<unsigned char *>(job.staging->map(static_cast<int>(size)));
+                job.staging->unbind();
+                if (job.staging_data == nullptr) {
+                    const std::lock_guard lock(mutex);
+                    --in_flight;
+                    throw std::runtime_error("Could not map a pixel unpack buffer.");
+                }
+#endif
+                ++staging_count;
+                submit(std::move(job));
+            }
+        }
+
+        /** Keep the staging buffer of an uploaded or dropped image for the next image. */
+        void recycle(Job &job) {
+#ifndef __EMSCRIPTEN__
+            if (job.staging && free_staging.size() < staging_limit) {
+                free_staging.push_back(std::move(job.staging));
+            }
+#else
+            static_cast<void>(job);
+#endif
+        }
+
+        void work() {
+            // Rows are flipped while staging; the flag is per thread so that other loads are not affected
+            stbi_set_flip_vertically_on_load_thread(false);
+
+            while (true) {
+                Job job;
+                {
+                    std::unique_lock lock(mutex);
+                    job_available.wait(lock, [this] { return stopping || !jobs.empty(); });
+                    if (stopping) return;
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+
+                // Textures destroyed before decoding are not worth decoding
+                if (!job.dropped()) {
+                    if (job.atlas) {
+                        job.atlas->prefetch();
+                        job.decoded = true;
+                    } else if (job.ktx) {
+                        job.ktx->prefetch();
+                        job.decoded = true;
+                    } else {
+                        job.decoded = decode(job);
+                    }
+                }
+
+                // Even dropped images go back to the OpenGL thread, which unmaps their staging memory
+                const std::lock_guard lock(mutex);
+                results.push_back(std::move(job));
+            }
+        }
+
+        /**
+         * Decode an image and copy it into its staging memory, flipping its rows during the copy. stb_image only
+         * decodes into memory it allocates itself, so the copy cannot be avoided, but it is the only one.
+         */
+        static bool decode(const Job &job) {
+            int width, height, n_original_channels;
+            const ImageData data(stbi_load(job.path.c_str(), &width, &height, &n_original_channels, 4),
+                                 stbi_image_free);
+
+            // The file may have changed since its size was read
+            if (data == nullptr || width != job.width || height != job.height) return false;
+
+            const auto row_size = static_cast<std::size_t>(width) * 4;
+            for (int row = 0; row < height; ++row) {
+                std::memcpy(job.staging_data + row_size * (height - 1 - row), data.get() + row_size * row, row_size);
+            }
+            return true;
+        }
+    };
+
+    TextureLoader::TextureLoader(unsigned int threads) : impl(std::make_unique<Impl>(threads)) {}
+
+    std::shared_ptr<Texture> TextureLoader::load(const std::string &path, bool mipmap) {
+        return impl->load(path, mipmap);
+    }
+
+    std::size_t TextureLoader::update(std::chrono::microseconds time_budget, std::size_t byte_budget) {
+        return impl->update(time_budget, byte_budget);
+    }
+
+    std::size_t TextureLoader::pending() const { return impl->pending(); }
+
+    TextureLoader::~TextureLoader() = default;
+
+}
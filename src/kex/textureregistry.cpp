@@ -0,0 +1,296 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "textureregistry.hpp"
+#include "spriteinstance.hpp"
+
+namespace kex {
+
+    struct Registry {
+        StableVector<TextureRecord, 256, 9> records;
+        std::vector<TextureHandle> free_handles;
+
+        /** Serializes registering textures and regions. */
+        std::mutex mutex;
+
+        /** Evicted textures drawn since, together with the serial of their records, to be reloaded by a loader. */
+        std::deque<std::pair<TextureHandle, std::uint32_t>> reload_requests;
+
+        std::size_t resident_bytes = 0;
+        std::size_t budget = 0; // Unlimited
+        std::uint64_t stamp = 0;
+        /** Number of live texture loaders. */
+        std::size_t loaders = 0;
+        std::size_t evictions = 0;
+        std::size_t reloads = 0;
+    };
+
+    static Registry &registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    /**
+     * Take a free record, or append one, and give it an empty table of regions. Must be called with the lock held.
+     */
+    static TextureHandle add_record(Registry &instance) {
+        auto &records = instance.records;
+        auto &free_handles = instance.free_handles;
+        TextureHandle handle;
+        if (!free_handles.empty()) {
+            handle = free_handles.back();
+            free_handles.pop_back();
+        } else {
+            if (records.size() > std::numeric_limits<TextureHandle>::max()) {
+                throw std::runtime_error("Too many textures");
+            }
+            handle = static_cast<TextureHandle>(records.size());
+            records.emplace_back();
+        }
+
+        auto &record = records[handle];
+        record.owned_region_table = std::make_unique<TextureRegionTable>();
+        record.region_table.store(record.owned_region_table.get(), std::memory_order_release);
+        return handle;
+    }
+
+    TextureHandle TextureRegistry::add(const Texture &texture) {
+        auto &instance = registry();
+        const std::lock_guard lock(instance.mutex);
+        const auto handle = add_record(instance);
+        auto &record = instance.records[handle];
+        record.texture = &texture;
+        record.id = texture.id();
+        record.width = texture.width();
+        record.height = texture.height();
+        record.top_down = texture.is_top_down();
+        return handle;
+    }
+
+    TextureHandle TextureRegistry::add(const TextureArray &texture_array) {
+        auto &instance = registry();
+        const std::lock_guard lock(instance.mutex);
+        const auto handle = add_record(instance);
+        auto &record = instance.records[handle];
+        record.texture_array = &texture_array;
+        record.id = texture_array.id();
+        record.width = texture_array.width();
+        record.height = texture_array.height();
+        return handle;
+    }
+
+    void TextureRegistry::remove(TextureHandle handle) {
+        auto &instance = registry();
+        const std::lock_guard lock(instance.mutex);
+        auto &record = instance.records[handle];
+        if (record.resident) {
+            instance.resident_bytes -= record.bytes;
+        }
+
+        // The record is reset in place, since it must not move
+        record.texture = nullptr;
+        record.texture_array = nullptr;
+        record.id = 0;
+        record.width = 0;
+        record.height = 0;
+        record.top_down = false;
+        record.bytes = 0;
+        record.last_used = 0;
+        record.evictable = false;
+        record.resident = true;
+        record.reload_requested = false;
+        ++record.serial;
+        record.region_table.store(nullptr, std::memory_order_release);
+        record.owned_region_table.reset();
+        record.region_indices.clear();
+        instance.free_handles.push_back(handle);
+    }
+
+    const TextureRecord &TextureRegistry::get(TextureHandle handle) { return registry().records[handle]; }
+
+    static void compute_coordinates(TextureRegion &region, const TextureRecord &record) {
+        const auto &rectangle = region.rectangle;
+        const auto width = static_cast<float>(record.width);
+        const auto height = static_cast<float>(record.height);
+        region.u_min = static_cast<float>(rectangle.x) / width;
+        region.u_max = static_cast<float>(rectangle.x + rectangle.w) / width;
+        if (record.top_down) {
+            // The bottom edge of the sprite samples the bottom edge of the region, which is further down the texture
+            region.v_min = static_cast<float>(rectangle.y + rectangle.h) / height;
+            region.v_max = static_cast<float>(rectangle.y) / height;
+        } else {
+            region.v_min = 1 - static_cast<float>(rectangle.y + rectangle.h) / height;
+            region.v_max = 1 - static_cast<float>(rectangle.y) / height;
+        }
+        region.packed[0] = pack_unorm16(region.u_min);
+        region.packed[1] = pack_unorm16(region.v_min);
+        region.packed[2] = pack_unorm16(region.u_max);
+        region.packed[3] = pack_unorm16(region.v_max);
+    }
+
+    void TextureRegistry::resize(TextureHandle handle, int width, int height, bool top_down) {
+        auto &instance = registry();
+        const std::lock_guard lock(instance.mutex);
+        auto &record = instance.records[handle];
+        record.width = width;
+        record.height = height;
+        record.top_down = top_down;
+
+        // Regions may be read while they are recomputed, so they are recomputed into a new table
+        const auto &regions = record.owned_region_table->regions;
+        auto table = std::make_unique<TextureRegionTable>();
+        for (std::size_t i = 0; i < regions.size(); ++i) {
+            auto &region = table->regions.emplace_back();
+            region = regions[i];
+            compute_coordinates(region, record);
+        }
+        record.region_table.store(table.get(), std::memory_order_release);
+        table->replaced = std::move(record.owned_region_table);
+        record.owned_region_table = std::move(table);
+    }
+
+    std::uint16_t TextureRegistry::region(TextureHandle handle, const RectangleDef &rectangle, int layer) {
+        auto &instance = registry();
+        const std::lock_guard lock(instance.mutex);
+        auto &record = instance.records[handle];
+        const TextureRegionKey key{rectangle.x, rectangle.y, rectangle.w, rectangle.h, layer};
+        const auto it = record.region_indices.find(key);
+        if (it != record.region_indices.end()) return it->second;
+
+        auto &regions = record.owned_region_table->regions;
+        if (regions.size() > std::numeric_limits<std::uint16_t>::max()) {
+            throw std::runtime_error("Too many regions of a texture");
+        }
+        auto &added = regions.emplace_back();
+        added.rectangle = rectangle;
+        added.layer = layer;
+        compute_coordinates(added, record);
+
+        const auto index = static_cast<std::uint16_t>(regions.size() - 1);
+        record.region_indices.emplace(key, index);
+        return index;
+    }
+
+    void TextureRegistry::track(TextureHandle handle, std::size_t bytes, bool evictable) {
+        auto &instance = registry();
+        auto &record = instance.records[handle];
+        if (record.resident) {
+            instance.resident_bytes -= record.bytes;
+        } else {
+            ++instance.reloads;
+        }
+        record.bytes = bytes;
+        record.evictable = evictable;
+        record.resident = true;
+        record.reload_requested = false;
+        record.last_used = instance.stamp;
+        instance.resident_bytes += bytes;
+        enforce_budget();
+    }
+
+    void TextureRegistry::next_frame() {
+        ++registry().stamp;
+        enforce_budget();
+    }
+
+    void TextureRegistry::use(TextureHandle handle) {
+        auto &instance = registry();
+        auto &record = instance.records[handle];
+        record.last_used = instance.stamp;
+        if (record.resident || record.reload_requested || record.texture == nullptr) return;
+        record.reload_requested = true;
+        instance.reload_requests.emplace_back(handle, record.serial);
+    }
+
+    void TextureRegistry::reload_queued() {
+        if (registry().loaders != 0) return;
+        TextureHandle handle;
+        while (next_reload(handle)) {
+            registry().records[handle].texture->reload();
+        }
+    }
+
+    void TextureRegistry::attach_loader() { ++registry().loaders; }
+
+    void TextureRegistry::detach_loader() {
+        auto &instance = registry();
+        --instance.loaders;
+
+        // Reloads taken by the loader are never completed, so the textures are queued again when they are drawn
+        for (std::size_t i = 0; i < instance.records.size(); ++i) {
+            instance.records[i].reload_requested = false;
+        }
+    }
+
+    bool TextureRegistry::next_reload(TextureHandle &handle) {
+        auto &requests = registry().reload_requests;
+        while (!requests.empty()) {
+            std::uint32_t serial;
+            std::tie(handle, serial) = requests.front();
+            requests.pop_front();
+
+            // The texture may have been destroyed since it was queued
+            const auto &record = registry().records[handle];
+            if (record.serial == serial && !record.resident) return true;
+        }
+        return false;
+    }
+
+    void TextureRegistry::enforce_budget() {
+        auto &instance = registry();
+        if (instance.budget == 0) return;
+        while (instance.resident_bytes > instance.budget) {
+            // Textures drawn in the current frame may be drawn again before it ends, so they are never evicted
+            TextureRecord *victim = nullptr;
+            for (std::size_t i = 0; i < instance.records.size(); ++i) {
+                auto &record = instance.records[i];
+                if (!record.resident || !record.evictable || record.last_used >= instance.stamp) continue;
+                if (victim == nullptr || record.last_used < victim->last_used) {
+                    victim = &record;
+                }
+            }
+            if (victim == nullptr) return;
+
+            victim->texture->evict();
+            victim->resident = false;
+            instance.resident_bytes -= victim->bytes;
+            ++instance.evictions;
+        }
+    }
+
+    void TextureRegistry::set_budget(std::size_t bytes) {
+        registry().budget = bytes;
+        enforce_budget();
+    }
+
+    std::size_t TextureRegistry::budget() { return registry().budget; }
+
+    std::size_t TextureRegistry::resident_bytes() { return registry().resident_bytes; }
+
+    std::size_t TextureRegistry::evictions() { return registry().evictions; }
+
+    std::size_t TextureRegistry::reloads() { return registry().reloads; }
+
+}
@@ -0,0 +1,249 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_TEXTUREREGISTRY_HPP
+#define KEX_TEXTUREREGISTRY_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <kex/texture.hpp>
+#include <kex/def.hpp>
+
+namespace kex {
+
+    /**
+     * Append-only storage whose elements never move, so that they can be read while other elements are appended.
+     *
+     * Elements are kept in segments that double in size, segment k holding FIRST << k elements. Appending must be
+     * serialized by the caller, whereas an element can be read on any thread once its index was handed over.
+     */
+    template<typename T, std::size_t FIRST, std::size_t SEGMENTS>
+    class StableVector {
+    public:
+        StableVector() = default;
+
+        StableVector(const StableVector &) = delete;
+
+        StableVector &operator=(const StableVector &) = delete;
+
+        [[nodiscard]] std::size_t size() const { return count.load(std::memory_order_acquire); }
+
+        static constexpr std::size_t capacity() { return FIRST * ((std::size_t{1} << SEGMENTS) - 1); }
+
+        T &operator[](std::size_t index) {
+            std::size_t offset;
+            const auto segment = locate(index, offset);
+            return segments[segment].load(std::memory_order_acquire)[offset];
+        }
+
+        const T &operator[](std::size_t index) const {
+            return const_cast<StableVector &>(*this)[index];
+        }
+
+        /** Append a default-constructed element, which is initialized by the caller before its index is handed over. */
+        T &emplace_back() {
+            const auto index = count.load(std::memory_order_relaxed);
+            std::size_t offset;
+            const auto segment = locate(index, offset);
+            if (offset == 0) {
+                segments[segment].store(new T[FIRST << segment], std::memory_order_release);
+            }
+            count.store(index + 1, std::memory_order_release);
+            return (*this)[index];
+        }
+
+        ~StableVector() {
+            for (auto &segment: segments) {
+                delete[] segment.load(std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        std::array<std::atomic<T *>, SEGMENTS> segments{};
+        std::atomic<std::size_t> count{0};
+
+        /** Find the segment of an element and its offset within the segment. */
+        static std::size_t locate(std::size_t index, std::size_t &offset) {
+            const auto blocks = index / FIRST + 1;
+            std::size_t segment = 0;
+            while (blocks >> (segment + 1) != 0) ++segment;
+            offset = index - FIRST * ((std::size_t{1} << segment) - 1);
+            return segment;
+        }
+    };
+
+    /**
+     * Region of a texture or of a texture array layer with precomputed texture coordinates.
+     */
+    struct TextureRegion {
+        RectangleDef rectangle;
+        int layer;
+        float u_min, u_max, v_min, v_max;
+
+        /** Texture coordinates as normalized unsigned shorts, in the order of SpriteInstance::tex_region. */
+        std::uint16_t packed[4];
+    };
+
+    struct TextureRegionKey {
+        int x, y, w, h, layer;
+
+        bool operator==(const TextureRegionKey &other) const {
+            return x == other.x && y == other.y && w == other.w && h == other.h && layer == other.layer;
+        }
+    };
+
+    struct TextureRegionKeyHash {
+        std::size_t operator()(const TextureRegionKey &key) const {
+            std::size_t hash = 0;
+            for (const auto value: {key.x, key.y, key.w, key.h, key.layer}) {
+                hash = hash * 31 + std::hash<int>()(value);
+            }
+            return hash;
+        }
+    };
+
+    /**
+     * Regions of a texture, which never change once added.
+     */
+    struct TextureRegionTable {
+        StableVector<TextureRegion, 64, 11> regions;
+
+        /** Table replaced by this one, kept alive for readers that may still refer to its regions. */
+        std::unique_ptr<TextureRegionTable> replaced;
+    };
+
+    /**
+     * Registered texture or texture array together with the table of its regions.
+     */
+    struct TextureRecord {
+        const Texture *texture = nullptr;
+        const TextureArray *texture_array = nullptr;
+        unsigned int id = 0;
+        int width = 0;
+        int height = 0;
+        bool top_down = false;
+
+        /** Size in video memory while the texture is resident. */
+        std::size_t bytes = 0;
+        /** Stamp of the last frame that drew the texture. */
+        std::uint64_t last_used = 0;
+        /** Whether the texture can be reloaded from its file after being evicted. */
+        bool evictable = false;
+        bool resident = true;
+        /** Whether the evicted texture is queued for reloading. */
+        bool reload_requested = false;
+        /** Incremented whenever the record is released, so that queued work can tell a reused handle apart. */
+        std::uint32_t serial = 0;
+
+        /** Current table of regions, replaced as a whole when the texture is resized. */
+        std::atomic<const TextureRegionTable *> region_table{nullptr};
+        std::unique_ptr<TextureRegionTable> owned_region_table;
+        std::unordered_map<TextureRegionKey, std::uint16_t, TextureRegionKeyHash> region_indices;
+
+        [[nodiscard]] const TextureRegion &region(std::uint16_t index) const {
+            return region_table.load(std::memory_order_acquire)->regions[index];
+        }
+    };
+
+    /**
+     * Table of all live textures and texture arrays, addressed by their handles.
+     *
+     * Textures register themselves on creation, which lets sprites refer to a texture and its region by two small
+     * indices. Registering textures and regions is serialized by a lock. Records and regions never move and regions
+     * never change once added, so they can be read on any thread without locking, e.g. while recording sprites.
+     * Only the OpenGL thread reads and writes the usage of textures.
+     */
+    class TextureRegistry {
+    public:
+        static TextureHandle add(const Texture &texture);
+
+        static TextureHandle add(const TextureArray &texture_array);
+
+        static void remove(TextureHandle handle);
+
+        static const TextureRecord &get(TextureHandle handle);
+
+        /**
+         * Update the size and orientation of a texture whose pixels were replaced, recomputing the coordinates of its
+         * regions.
+         */
+        static void resize(TextureHandle handle, int width, int height, bool top_down);
+
+        /**
+         * Find the index of a region in the table of a texture, adding the region if it is not there yet.
+         */
+        static std::uint16_t region(TextureHandle handle, const RectangleDef &rectangle, int layer = 0);
+
+        /**
+         * Record the size of a texture whose pixels were uploaded, evicting other textures if the budget is exceeded.
+         */
+        static void track(TextureHandle handle, std::size_t bytes, bool evictable);
+
+        /**
+         * Start a new frame, which makes the textures drawn so far candidates for eviction, and evict textures if the
+         * budget is exceeded.
+         */
+        static void next_frame();
+
+        /** Mark a texture as drawn in the current frame, queueing it for reloading if it was evicted. */
+        static void use(TextureHandle handle);
+
+        /**
+         * Reload the queued textures on the calling thread unless a TextureLoader is alive to reload them
+         * asynchronously. Called after marking all textures of a draw as used, so that none of them is evicted again.
+         */
+        static void reload_queued();
+
+        /** Register a live TextureLoader, which takes over reloading evicted textures. */
+        static void attach_loader();
+
+        /** Unregister a TextureLoader, whose reloads which are not done yet are requested again by later draws. */
+        static void detach_loader();
+
+        /**
+         * Take the next evicted texture queued for reloading.
+         *
+         * @return Whether there was a queued texture
+         */
+        static bool next_reload(TextureHandle &handle);
+
+        /** Evict the least recently used textures until the resident ones fit into the budget. */
+        static void enforce_budget();
+
+        static void set_budget(std::size_t bytes);
+
+        static std::size_t budget();
+
+        static std::size_t resident_bytes();
+
+        static std::size_t evictions();
+
+        static std::size_t reloads();
+
+        TextureRegistry() = delete;
+    };
+
+}
+
+#endif //KEX_TEXTUREREGISTRY_HPP
@@ -17,6 +17,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
 #include <kex/vertexarray.hpp>
+#include <kex/state.hpp>
+
+#include <vector>
 
 #include <glad/gles2.h>
 
@@ -29,11 +32,11 @@ namespace kex {
         }
 
         void bind() const {
-            glBindVertexArray(id);
+            StateCache::bind_vertex_array(id);
         }
 
         template<VertexAttr Attr, int Div, bool Norm, BufferUsage Usg>
-        void add_attribute(const ArrayBuffer<Usg> &array_buffer) {
+        void add_attribute(const ArrayBuffer<Usg> &array_buffer, int stride, int offset) {
             this->bind();
             array_buffer.bind();
 
@@ -41,22 +44,51 @@ namespace kex {
             GLint size;
             GLenum type;
             GLboolean normalized;
-            GLsizei stride = 0;
             int item_offset = 0;
-            if constexpr (Attr == VertexAttr::VEC2) {
+            if constexpr (Attr == VertexAttr::FLOAT) {
+                count = 1;
+                size = 1;
+                type = GL_FLOAT;
+            } else if constexpr (Attr == VertexAttr::FLOAT_USHORT) {
+                count = 1;
+                size = 1;
+                type = GL_UNSIGNED_SHORT;
+            } else if constexpr (Attr == VertexAttr::VEC2) {
                 count = 1;
                 size = 2;
                 type = GL_FLOAT;
+            } else if constexpr (Attr == VertexAttr::VEC2_HALF) {
+                count = 1;
+                size = 2;
+                type = GL_HALF_FLOAT;
             } else if constexpr (Attr == VertexAttr::VEC4) {
                 count = 1;
                 size = 4;
                 type = GL_FLOAT;
+            } else if constexpr (Attr == VertexAttr::VEC4_UBYTE) {
+                count = 1;
+                size = 4;
+                type = GL_UNSIGNED_BYTE;
+            } else if constexpr (Attr == VertexAttr::VEC4_USHORT) {
+                count = 1;
+                size = 4;
+                type = GL_UNSIGNED_SHORT;
             } else if constexpr (Attr == VertexAttr::MAT3) {
                 count = 3;
                 size = 3;
                 type = GL_FLOAT;
-                stride = 3 * 3 * sizeof(float);
+                if (stride == 0) {
+                    stride = 3 * 3 * sizeof(float);
+                }
                 item_offset = 3 * sizeof(float);
+            } else if constexpr (Attr == VertexAttr::MAT3X2) {
+                count = 3;
+                size = 2;
+                type = GL_FLOAT;
+                if (stride == 0) {
+                    stride = 3 * 2 * sizeof(float);
+                }
+                item_offset = 2 * sizeof(float);
             }
 
             if constexpr (Norm) {
@@ -65,25 +97,52 @@ namespace kex {
                 normalized = GL_FALSE;
             }
 
-            int current_offset = 0;
+            int current_offset = offset;
             while (count-- > 0) {
                 glEnableVertexAttribArray(current_index);
                 glVertexAttribPointer(current_index, size, type, normalized, stride,
                                       reinterpret_cast<const void *>(current_offset));
                 glVertexAttribDivisor(current_index, Div);
+                attributes.push_back({array_buffer.id(), current_index, size, type, normalized, stride, current_offset});
                 ++current_index;
                 current_offset += item_offset;
             }
 
         }
 
+        template<BufferUsage Usg>
+        void rebase(const ArrayBuffer<Usg> &array_buffer, int base_offset) {
+            this->bind();
+            array_buffer.bind();
+
+            // Re-specify the attributes sourced from the buffer so that they start at the base offset
+            for (const auto &attribute: attributes) {
+                if (attribute.buffer_id != array_buffer.id()) continue;
+                glVertexAttribPointer(attribute.index, attribute.size, attribute.type, attribute.normalized,
+                                      attribute.stride,
+                                      reinterpret_cast<const void *>(base_offset + attribute.offset));
+            }
+        }
+
         ~Impl() {
             glDeleteVertexArrays(1, &id);
+            StateCache::forget_vertex_array(id);
         }
 
     private:
+        struct Attribute {
+            GLuint buffer_id;
+            GLuint index;
+            GLint size;
+            GLenum type;
+            GLboolean normalized;
+            GLsizei stride;
+            int offset;
+        };
+
         GLuint id = 0;
         GLuint current_index = 0;
+        std::vector<Attribute> attributes;
 
         friend VertexArray;
     };
@@ -98,25 +157,75 @@ namespace kex {
 
     template<VertexAttr Attr, int Div, bool Norm, BufferUsage Usg>
     void
-    VertexArray::add_attribute(const ArrayBuffer<Usg> &array_buffer) {
-        impl->add_attribute<Attr, Div, Norm>(array_buffer);
+    VertexArray::add_attribute(const ArrayBuffer<Usg> &array_buffer, int stride, int offset) {
+        impl->add_attribute<Attr, Div, Norm>(array_buffer, stride, offset);
+    }
+
+    template<BufferUsage Usg>
+    void VertexArray::rebase(const ArrayBuffer<Usg> &array_buffer, int base_offset) {
+        impl->rebase(array_buffer, base_offset);
     }
 
     VertexArray::~VertexArray() = default;
 
     // Specializations
     template void VertexArray::add_attribute<VertexAttr::VEC2, 0, false, BufferUsage::STATIC>(
-            const ArrayBuffer<BufferUsage::STATIC> &array_buffer);
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
 
     template void VertexArray::add_attribute<VertexAttr::VEC2, 0, false, BufferUsage::STREAM>(
-            const ArrayBuffer<BufferUsage::STREAM> &array_buffer);
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
 
     template void VertexArray::add_attribute<VertexAttr::VEC2, 1, false, BufferUsage::STREAM>(
-            const ArrayBuffer<BufferUsage::STREAM> &array_buffer);
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::FLOAT, 1, false, BufferUsage::STREAM>(
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::VEC2_HALF, 1, false, BufferUsage::STREAM>(
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
 
     template void VertexArray::add_attribute<VertexAttr::VEC4, 1, false, BufferUsage::STREAM>(
-            const ArrayBuffer<BufferUsage::STREAM> &array_buffer);
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
 
     template void VertexArray::add_attribute<VertexAttr::MAT3, 1, false, BufferUsage::STREAM>(
-            const ArrayBuffer<BufferUsage::STREAM> &array_buffer);
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::MAT3X2, 1, false, BufferUsage::STREAM>(
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::VEC4_UBYTE, 1, true, BufferUsage::STREAM>(
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::VEC4_USHORT, 1, true, BufferUsage::STREAM>(
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::FLOAT_USHORT, 1, false, BufferUsage::STREAM>(
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::FLOAT, 1, false, BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::VEC2_HALF, 1, false, BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::VEC4, 1, false, BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::MAT3X2, 1, false, BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::VEC4_UBYTE, 1, true, BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::VEC4_USHORT, 1, true, BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
+
+    template void VertexArray::add_attribute<VertexAttr::FLOAT_USHORT, 1, false, BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int stride, int offset);
+
+    template void VertexArray::rebase<BufferUsage::STATIC>(
+            const ArrayBuffer<BufferUsage::STATIC> &array_buffer, int base_offset);
+
+    template void VertexArray::rebase<BufferUsage::STREAM>(
+            const ArrayBuffer<BufferUsage::STREAM> &array_buffer, int base_offset);
 }
\ No newline at end of file
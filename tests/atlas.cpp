@@ -0,0 +1,151 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <kex/atlas.hpp>
+
+#include "check.hpp"
+
+using namespace kex;
+
+/** Pixels whose color encodes the image and the position, so that misplaced pixels are detected. */
+static std::vector<unsigned char> make_pixels(int image, int width, int height) {
+    std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            auto *pixel = &pixels[(static_cast<std::size_t>(y) * width + x) * 4];
+            pixel[0] = static_cast<unsigned char>(image);
+            pixel[1] = static_cast<unsigned char>(x);
+            pixel[2] = static_cast<unsigned char>(y);
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+static const unsigned char *pixel_at(const AtlasImage &atlas, int x, int y) {
+    return &atlas.pixels[(static_cast<std::size_t>(y) * atlas.width + x) * 4];
+}
+
+static bool is_power_of_two(int value) { return value > 0 && (value & (value - 1)) == 0; }
+
+static void test_no_overlaps(int padding) {
+    std::mt19937 random(static_cast<std::uint32_t>(42 + padding));
+    std::uniform_int_distribution<int> size(1, 40);
+    AtlasBuilder builder(1024, padding);
+    std::vector<std::vector<unsigned char>> images;
+    for (int i = 0; i < 150; ++i) {
+        const auto width = size(random);
+        const auto height = size(random);
+        images.push_back(make_pixels(i, width, height));
+        builder.add_pixels(std::to_string(i), images.back().data(), width, height);
+    }
+    const auto atlas = builder.compose();
+    KEX_CHECK(is_power_of_two(atlas.width) && is_power_of_two(atlas.height));
+    KEX_CHECK(atlas.regions.size() == images.size());
+
+    for (std::size_t i = 0; i < atlas.regions.size(); ++i) {
+        const auto &[name, a] = atlas.regions[i];
+        KEX_CHECK(name == std::to_string(i));
+
+        // The padding stays within the atlas
+        KEX_CHECK(a.x - padding >= 0 && a.y - padding >= 0);
+        KEX_CHECK(a.x + a.w + padding <= atlas.width && a.y + a.h + padding <= atlas.height);
+
+        // Padded regions do not overlap
+        for (std::size_t j = 0; j < i; ++j) {
+            const auto &b = atlas.regions[j].rectangle;
+            const bool apart = a.x + a.w + padding <= b.x - padding || b.x + b.w + padding <= a.x - padding ||
+                               a.y + a.h + padding <= b.y - padding || b.y + b.h + padding <= a.y - padding;
+            KEX_CHECK(apart);
+        }
+
+        // Pixels are copied starting with the top row
+        const auto width = a.w;
+        bool copied = true;
+        for (int y = 0; y < a.h; ++y) {
+            copied &= std::memcmp(pixel_at(atlas, a.x, a.y + y), &images[i][static_cast<std::size_t>(y) * width * 4],
+                                  static_cast<std::size_t>(width) * 4) == 0;
+        }
+        KEX_CHECK(copied);
+    }
+}
+
+static void test_padding_repeats_edges() {
+    const int padding = 2;
+    AtlasBuilder builder(256, padding);
+    const auto pixels = make_pixels(7, 5, 3);
+    builder.add_pixels("image", pixels.data(), 5, 3);
+    const auto atlas = builder.compose();
+    const auto &region = atlas.regions[0].rectangle;
+
+    // Every padding pixel repeats the nearest pixel of the image, including the corners
+    for (int y = region.y - padding; y < region.y + region.h + padding; ++y) {
+        for (int x = region.x - padding; x < region.x + region.w + padding; ++x) {
+            const auto nearest_x = std::min(std::max(x, region.x), region.x + region.w - 1);
+            const auto nearest_y = std::min(std::max(y, region.y), region.y + region.h - 1);
+            KEX_CHECK(std::memcmp(pixel_at(atlas, x, y), pixel_at(atlas, nearest_x, nearest_y), 4) == 0);
+        }
+    }
+}
+
+static void test_tight_fit() {
+    // Four equal images without padding fill the smallest atlas exactly
+    AtlasBuilder builder(64, 0);
+    std::vector<std::vector<unsigned char>> images;
+    for (int i = 0; i < 4; ++i) {
+        images.push_back(make_pixels(i, 16, 16));
+        builder.add_pixels(std::to_string(i), images.back().data(), 16, 16);
+    }
+    const auto atlas = builder.compose();
+    KEX_CHECK(atlas.width == 32 && atlas.height == 32);
+}
+
+static void test_errors() {
+    const auto pixels = make_pixels(0, 40, 40);
+    AtlasBuilder empty;
+    KEX_CHECK_THROWS(static_cast<void>(empty.compose()), std::runtime_error);
+
+    AtlasBuilder builder(64, 1);
+    builder.add_pixels("a", pixels.data(), 40, 40);
+    KEX_CHECK_THROWS(builder.add_pixels("a", pixels.data(), 40, 40), std::invalid_argument);
+    KEX_CHECK_THROWS(builder.add_pixels("b", pixels.data(), 0, 40), std::invalid_argument);
+
+    // Two padded 40x40 images do not fit into 64x64
+    builder.add_pixels("b", pixels.data(), 40, 40);
+    KEX_CHECK_THROWS(static_cast<void>(builder.compose()), std::runtime_error);
+
+    KEX_CHECK_THROWS(AtlasBuilder(0, 1), std::invalid_argument);
+    KEX_CHECK_THROWS(AtlasBuilder(64, -1), std::invalid_argument);
+}
+
+int main() {
+    test_no_overlaps(0);
+    test_no_overlaps(1);
+    test_no_overlaps(3);
+    test_padding_repeats_edges();
+    test_tight_fit();
+    test_errors();
+    return kex::test::result();
+}
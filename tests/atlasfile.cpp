@@ -0,0 +1,206 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <kex/atlas.hpp>
+#include <kex/atlasfile.hpp>
+
+#include "check.hpp"
+
+using namespace kex;
+
+static std::string temp_path(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / ("kex-test-" + name)).string();
+}
+
+static std::vector<char> read_bytes(const std::string &path) {
+    std::ifstream stream(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+}
+
+static void write_bytes(const std::string &path, const std::vector<char> &bytes) {
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+/** Pixels whose color encodes the image and the position, so that misplaced pixels are detected. */
+static std::vector<unsigned char> make_pixels(int image, int width, int height) {
+    std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            auto *pixel = &pixels[(static_cast<std::size_t>(y) * width + x) * 4];
+            pixel[0] = static_cast<unsigned char>(image);
+            pixel[1] = static_cast<unsigned char>(x);
+            pixel[2] = static_cast<unsigned char>(y);
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+static AtlasImage make_atlas() {
+    AtlasBuilder builder(256, 1);
+    std::vector<std::vector<unsigned char>> images;
+    for (int i = 0; i < 12; ++i) {
+        const auto width = 5 + i * 3;
+        const auto height = 30 - i * 2;
+        images.push_back(make_pixels(i, width, height));
+        builder.add_pixels("image" + std::to_string(i), images.back().data(), width, height);
+    }
+    return builder.compose();
+}
+
+static void test_round_trip(bool mipmap) {
+    const auto atlas = make_atlas();
+    const auto path = temp_path("round-trip.kexa");
+    atlas.save(path, mipmap);
+    KEX_CHECK(AtlasFile::is_atlas_file(path));
+
+    const AtlasFile file(path);
+    const auto &header = file.header();
+    KEX_CHECK(std::memcmp(header.magic, ATLAS_FILE_MAGIC, sizeof(ATLAS_FILE_MAGIC)) == 0);
+    KEX_CHECK(header.version == ATLAS_FILE_VERSION);
+    KEX_CHECK(header.width == static_cast<std::uint32_t>(atlas.width));
+    KEX_CHECK(header.height == static_cast<std::uint32_t>(atlas.height));
+    KEX_CHECK(header.regions == atlas.regions.size());
+
+    // A full mip chain ends with a single pixel
+    std::uint32_t levels = 1;
+    while (mipmap && (level_size(header.width, levels - 1) > 1 || level_size(header.height, levels - 1) > 1)) {
+        ++levels;
+    }
+    KEX_CHECK(header.levels == levels);
+
+    // Regions are sorted by hash and keep their rectangles
+    const auto *regions = file.regions();
+    for (std::uint32_t i = 1; i < header.regions; ++i) {
+        KEX_CHECK(regions[i - 1].name_hash < regions[i].name_hash);
+    }
+    for (const auto &[name, rectangle]: atlas.regions) {
+        const auto hash = hash_name(name);
+        const auto *region = std::find_if(regions, regions + header.regions, [&](const AtlasFileRegion &r) {
+            return r.name_hash == hash;
+        });
+        KEX_CHECK(region != regions + header.regions);
+        if (region == regions + header.regions) continue;
+        KEX_CHECK(region->x == rectangle.x && region->y == rectangle.y);
+        KEX_CHECK(region->w == rectangle.w && region->h == rectangle.h);
+    }
+
+    // The base level starts with the bottom row of the atlas
+    const auto row_size = static_cast<std::size_t>(atlas.width) * 4;
+    bool flipped = true;
+    for (int row = 0; row < atlas.height; ++row) {
+        flipped &= std::memcmp(file.level(0) + row_size * (atlas.height - 1 - row),
+                               atlas.pixels.data() + row_size * row, row_size) == 0;
+    }
+    KEX_CHECK(flipped);
+
+    // The file holds exactly the header, the regions and the levels
+    auto size = sizeof(AtlasFileHeader) + header.regions * sizeof(AtlasFileRegion);
+    for (std::uint32_t level = 0; level < header.levels; ++level) {
+        size += static_cast<std::size_t>(level_size(header.width, level)) * level_size(header.height, level) * 4;
+    }
+    KEX_CHECK(std::filesystem::file_size(path) == size);
+    std::filesystem::remove(path);
+}
+
+static void test_is_atlas_file() {
+    const auto path = temp_path("not-an-atlas");
+    write_bytes(path, {'K', 'E', 'X', 'B', 0, 0, 0, 0});
+    KEX_CHECK(!AtlasFile::is_atlas_file(path));
+    write_bytes(path, {'K', 'E', 'X'});
+    KEX_CHECK(!AtlasFile::is_atlas_file(path));
+    std::filesystem::remove(path);
+    KEX_CHECK(!AtlasFile::is_atlas_file(path));
+}
+
+static void test_write_rejects_collisions() {
+    const auto path = temp_path("collision.kexa");
+    const std::vector<std::vector<unsigned char>> levels{std::vector<unsigned char>(4 * 4 * 4)};
+    KEX_CHECK_THROWS(AtlasFile::write(path, 4, 4, levels, {{7, 0, 0, 1, 1}, {7, 1, 1, 2, 2}}), std::runtime_error);
+
+    AtlasFile::write(path, 4, 4, levels, {{9, 0, 0, 4, 4}, {3, 1, 1, 2, 2}});
+    const AtlasFile file(path);
+    KEX_CHECK(file.header().regions == 2);
+    KEX_CHECK(file.regions()[0].name_hash == 3 && file.regions()[1].name_hash == 9);
+    std::filesystem::remove(path);
+}
+
+/** Overwrite a 32-bit field of the header at the given byte offset. */
+static std::vector<char> patched(std::vector<char> bytes, std::size_t offset, std::uint32_t value) {
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    return bytes;
+}
+
+static void test_bounds_checks() {
+    const auto valid = temp_path("valid.kexa");
+    make_atlas().save(valid, true);
+    const auto bytes = read_bytes(valid);
+    std::filesystem::remove(valid);
+
+    const auto path = temp_path("invalid.kexa");
+    const auto rejects = [&](const std::vector<char> &contents) {
+        write_bytes(path, contents);
+        KEX_CHECK_THROWS(AtlasFile file(path), std::runtime_error);
+    };
+
+    // Truncated anywhere, including within the header and the regions
+    for (const auto size: {std::size_t{0}, std::size_t{3}, sizeof(AtlasFileHeader) - 1, sizeof(AtlasFileHeader) + 5,
+                           bytes.size() / 2, bytes.size() - 1}) {
+        rejects({bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)});
+    }
+
+    rejects(patched(bytes, 0, 0x4258454b)); // Magic "KEXB"
+    rejects(patched(bytes, offsetof(AtlasFileHeader, version), ATLAS_FILE_VERSION + 1));
+    rejects(patched(bytes, offsetof(AtlasFileHeader, width), 0));
+    rejects(patched(bytes, offsetof(AtlasFileHeader, height), 0));
+    rejects(patched(bytes, offsetof(AtlasFileHeader, levels), 0));
+    rejects(patched(bytes, offsetof(AtlasFileHeader, levels), 33));
+    rejects(patched(bytes, offsetof(AtlasFileHeader, width), 0x10000));
+    rejects(patched(bytes, offsetof(AtlasFileHeader, regions), 0xffffffff));
+
+    // Regions must lie within the atlas
+    const auto region = sizeof(AtlasFileHeader);
+    rejects(patched(bytes, region + offsetof(AtlasFileRegion, x), 0xffffffff));
+    rejects(patched(bytes, region + offsetof(AtlasFileRegion, w), 0x7fffffff));
+    rejects(patched(bytes, region + offsetof(AtlasFileRegion, h), 0xffffffff));
+
+    write_bytes(path, bytes);
+    const AtlasFile file(path);
+    KEX_CHECK(file.header().regions == 12);
+    std::filesystem::remove(path);
+}
+
+int main() {
+    test_round_trip(false);
+    test_round_trip(true);
+    test_is_atlas_file();
+    test_write_rejects_collisions();
+    test_bounds_checks();
+    return kex::test::result();
+}
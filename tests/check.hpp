@@ -0,0 +1,56 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KEX_TESTS_CHECK_HPP
+#define KEX_TESTS_CHECK_HPP
+
+#include <cstdio>
+
+/**
+ * Minimal assertions for the unit tests, which count failures instead of aborting so that one run reports all of them.
+ */
+namespace kex::test {
+
+    inline int failures = 0;
+
+    inline void check(bool condition, const char *expression, const char *file, int line) {
+        if (condition) return;
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++failures;
+    }
+
+    /** Exit code of the test: zero if all checks passed. */
+    inline int result() { return failures == 0 ? 0 : 1; }
+
+}
+
+#define KEX_CHECK(condition) kex::test::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+/** Check that evaluating the statement throws an exception of the specified type. */
+#define KEX_CHECK_THROWS(statement, exception)                                                                       \
+    do {                                                                                                             \
+        bool thrown = false;                                                                                         \
+        try {                                                                                                        \
+            statement;                                                                                               \
+        } catch (const exception &) {                                                                                \
+            thrown = true;                                                                                           \
+        }                                                                                                            \
+        kex::test::check(thrown, #statement " throws " #exception, __FILE__, __LINE__);                              \
+    } while (false)
+
+#endif //KEX_TESTS_CHECK_HPP
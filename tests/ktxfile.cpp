@@ -0,0 +1,387 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <glad/gles2.h>
+#include <kex/ktxfile.hpp>
+
+#include "check.hpp"
+
+using namespace kex;
+
+static const std::vector<unsigned char> KTX1_IDENTIFIER = {
+        0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+static const std::vector<unsigned char> KTX2_IDENTIFIER = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+/** Little-endian byte writer for crafting files, which optionally swaps 32-bit values. */
+struct Bytes {
+    std::vector<unsigned char> data;
+    bool swap = false;
+
+    void u32(std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            data.push_back(static_cast<unsigned char>(value >> (swap ? 24 - 8 * i : 8 * i)));
+        }
+    }
+
+    void u64(std::uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            data.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+
+    void bytes(const std::vector<unsigned char> &values) { data.insert(data.end(), values.begin(), values.end()); }
+
+    void pad() {
+        while (data.size() % 4 != 0) data.push_back(0);
+    }
+
+    void put_u32(std::size_t offset, std::uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            data[offset + i] = static_cast<unsigned char>(value >> (swap ? 24 - 8 * i : 8 * i));
+        }
+    }
+};
+
+/** Contents of a compressed mip level, filled with a value that identifies the level. */
+static std::vector<unsigned char> level_data(std::uint32_t level, std::size_t size) {
+    return std::vector<unsigned char>(size, static_cast<unsigned char>(0x10 + level));
+}
+
+/** Key/value entry of the orientation, padded to 4 bytes. */
+static void orientation(Bytes &file, const std::string &value) {
+    static constexpr char KEY[] = "KTXorientation";
+    file.u32(static_cast<std::uint32_t>(sizeof(KEY) + value.size() + 1));
+    file.bytes({KEY, KEY + sizeof(KEY)});
+    file.bytes({value.begin(), value.end()});
+    file.data.push_back(0);
+    file.pad();
+}
+
+struct Ktx1Options {
+    bool swap = false;
+    std::string orientation;
+};
+
+/** Offsets of the KTX 1 header fields after the identifier and the endianness. */
+enum Ktx1Field {
+    KTX1_GL_TYPE = 16, KTX1_INTERNAL_FORMAT = 28, KTX1_WIDTH = 36, KTX1_HEIGHT = 40, KTX1_DEPTH = 44,
+    KTX1_ARRAY_ELEMENTS = 48, KTX1_FACES = 52, KTX1_LEVELS = 56, KTX1_KEY_VALUE_SIZE = 60, KTX1_HEADER_SIZE = 64
+};
+
+/** KTX 1 file of a 10x6 texture compressed with RGB8 ETC2 with 3 mip levels of 48, 16 and 8 bytes. */
+static Bytes make_ktx1(const Ktx1Options &options = {}) {
+    Bytes file;
+    file.swap = options.swap;
+    file.bytes(KTX1_IDENTIFIER);
+    file.u32(0x04030201);
+    file.u32(0);                         // glType
+    file.u32(1);                         // glTypeSize
+    file.u32(0);                         // glFormat
+    file.u32(GL_COMPRESSED_RGB8_ETC2);   // glInternalFormat
+    file.u32(GL_RGB);                    // glBaseInternalFormat
+    file.u32(10);                        // pixelWidth
+    file.u32(6);                         // pixelHeight
+    file.u32(0);                         // pixelDepth
+    file.u32(0);                         // numberOfArrayElements
+    file.u32(1);                         // numberOfFaces
+    file.u32(3);                         // numberOfMipmapLevels
+
+    Bytes key_values;
+    key_values.swap = options.swap;
+    if (!options.orientation.empty()) orientation(key_values, options.orientation);
+    file.u32(static_cast<std::uint32_t>(key_values.data.size()));
+    file.bytes(key_values.data);
+
+    const std::size_t sizes[] = {48, 16, 8};
+    for (std::uint32_t level = 0; level < 3; ++level) {
+        file.u32(static_cast<std::uint32_t>(sizes[level]));
+        file.bytes(level_data(level, sizes[level]));
+        file.pad();
+    }
+    return file;
+}
+
+/** Offsets of the KTX 2 header fields after the identifier. */
+enum Ktx2Field {
+    KTX2_FORMAT = 12, KTX2_WIDTH = 20, KTX2_HEIGHT = 24, KTX2_DEPTH = 28, KTX2_LAYERS = 32, KTX2_FACES = 36,
+    KTX2_LEVELS = 40, KTX2_SUPERCOMPRESSION = 44, KTX2_KEY_VALUE_OFFSET = 56, KTX2_KEY_VALUE_SIZE = 60,
+    KTX2_HEADER_SIZE = 80
+};
+
+/**
+ * KTX 2 file of an 8x8 texture compressed with RGBA8 ETC2 EAC with 4 mip levels of 64, 16, 16 and 16 bytes, which are
+ * stored starting with the smallest level as the specification recommends.
+ */
+static Bytes make_ktx2(const std::string &orientation_value = {}) {
+    static constexpr std::uint32_t LEVELS = 4;
+    static constexpr std::size_t LEVEL_INDEX_SIZE = LEVELS * 3 * 8;
+    const std::size_t sizes[LEVELS] = {64, 16, 16, 16};
+
+    Bytes key_values;
+    if (!orientation_value.empty()) orientation(key_values, orientation_value);
+    const auto key_value_offset = KTX2_HEADER_SIZE + LEVEL_INDEX_SIZE;
+
+    // Levels start after the key/value data, aligned to the block size
+    std::size_t level_offsets[LEVELS];
+    auto offset = (key_value_offset + key_values.data.size() + 15) / 16 * 16;
+    for (auto level = LEVELS; level-- > 0;) {
+        level_offsets[level] = offset;
+        offset += sizes[level];
+    }
+
+    Bytes file;
+    file.bytes(KTX2_IDENTIFIER);
+    file.u32(151);                       // vkFormat: VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+    file.u32(1);                         // typeSize
+    file.u32(8);                         // pixelWidth
+    file.u32(8);                         // pixelHeight
+    file.u32(0);                         // pixelDepth
+    file.u32(0);                         // layerCount
+    file.u32(1);                         // faceCount
+    file.u32(LEVELS);                    // levelCount
+    file.u32(0);                         // supercompressionScheme
+    file.u32(0);                         // dfdByteOffset
+    file.u32(0);                         // dfdByteLength
+    file.u32(static_cast<std::uint32_t>(key_value_offset));
+    file.u32(static_cast<std::uint32_t>(key_values.data.size()));
+    file.u64(0);                         // sgdByteOffset
+    file.u64(0);                         // sgdByteLength
+    for (std::uint32_t level = 0; level < LEVELS; ++level) {
+        file.u64(level_offsets[level]);
+        file.u64(sizes[level]);
+        file.u64(sizes[level]);
+    }
+    file.bytes(key_values.data);
+    while (file.data.size() % 16 != 0) file.data.push_back(0);
+    for (auto level = LEVELS; level-- > 0;) {
+        file.bytes(level_data(level, sizes[level]));
+    }
+    return file;
+}
+
+/** Offset of a field of the KTX 2 level index entry of a level. */
+static std::size_t ktx2_level_entry(std::uint32_t level, int field) {
+    return KTX2_HEADER_SIZE + level * 24 + field * 8;
+}
+
+static std::string write_file(const std::string &name, const std::vector<unsigned char> &bytes) {
+    const auto path = (std::filesystem::temp_directory_path() / ("kex-test-" + name)).string();
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return path;
+}
+
+static bool has_level(const KtxFile &file, std::uint32_t level, int width, int height, std::size_t size) {
+    const auto &levels = file.mip_levels();
+    if (level >= levels.size()) return false;
+    const auto &actual = levels[level];
+    if (actual.width != width || actual.height != height || actual.size != size) return false;
+    for (std::size_t i = 0; i < size; ++i) {
+        if (actual.data[i] != 0x10 + level) return false;
+    }
+    return true;
+}
+
+static void test_ktx1(bool swap) {
+    const auto path = write_file("ktx1.ktx", make_ktx1({swap, {}}).data);
+    KEX_CHECK(KtxFile::is_ktx_file(path));
+    const KtxFile file(path);
+    KEX_CHECK(file.internal_format() == GL_COMPRESSED_RGB8_ETC2);
+    KEX_CHECK(file.width() == 10 && file.height() == 6);
+    KEX_CHECK(file.mip_levels().size() == 3);
+    KEX_CHECK(has_level(file, 0, 10, 6, 48));
+    KEX_CHECK(has_level(file, 1, 5, 3, 16));
+    KEX_CHECK(has_level(file, 2, 2, 1, 8));
+    KEX_CHECK(file.is_top_down());
+    std::filesystem::remove(path);
+}
+
+static void test_ktx1_orientation() {
+    for (const auto swap: {false, true}) {
+        const auto path = write_file("ktx1-orientation.ktx", make_ktx1({swap, "S=r,T=u"}).data);
+        const KtxFile file(path);
+        KEX_CHECK(!file.is_top_down());
+        KEX_CHECK(has_level(file, 0, 10, 6, 48));
+        std::filesystem::remove(path);
+    }
+    const auto path = write_file("ktx1-orientation.ktx", make_ktx1({false, "S=r,T=d"}).data);
+    KEX_CHECK(KtxFile(path).is_top_down());
+    std::filesystem::remove(path);
+}
+
+static void test_ktx2() {
+    const auto path = write_file("ktx2.ktx2", make_ktx2().data);
+    KEX_CHECK(KtxFile::is_ktx_file(path));
+    const KtxFile file(path);
+    KEX_CHECK(file.internal_format() == GL_COMPRESSED_RGBA8_ETC2_EAC);
+    KEX_CHECK(file.width() == 8 && file.height() == 8);
+    KEX_CHECK(file.mip_levels().size() == 4);
+    KEX_CHECK(has_level(file, 0, 8, 8, 64));
+    KEX_CHECK(has_level(file, 1, 4, 4, 16));
+    KEX_CHECK(has_level(file, 2, 2, 2, 16));
+    KEX_CHECK(has_level(file, 3, 1, 1, 16));
+    KEX_CHECK(file.is_top_down());
+    std::filesystem::remove(path);
+
+    const auto flipped = write_file("ktx2-orientation.ktx2", make_ktx2("ru").data);
+    KEX_CHECK(!KtxFile(flipped).is_top_down());
+    KEX_CHECK(has_level(KtxFile(flipped), 3, 1, 1, 16));
+    std::filesystem::remove(flipped);
+}
+
+static void test_ktx2_formats() {
+    // Every ETC2 and EAC format from VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK to VK_FORMAT_EAC_R11G11_SNORM_BLOCK
+    const GLenum formats[] = {
+            GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_SRGB8_ETC2, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+            GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC,
+            GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, GL_COMPRESSED_R11_EAC, GL_COMPRESSED_SIGNED_R11_EAC,
+            GL_COMPRESSED_RG11_EAC, GL_COMPRESSED_SIGNED_RG11_EAC,
+    };
+    for (std::uint32_t i = 0; i < 10; ++i) {
+        const auto block_size = formats[i] == GL_COMPRESSED_RGBA8_ETC2_EAC ||
+                                formats[i] == GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC ||
+                                formats[i] == GL_COMPRESSED_RG11_EAC ||
+                                formats[i] == GL_COMPRESSED_SIGNED_RG11_EAC ? 16u : 8u;
+        auto file = make_ktx2();
+        file.put_u32(KTX2_FORMAT, 147 + i);
+        file.put_u32(KTX2_LEVELS, 1);
+        const auto offset = file.data.size() - 64;
+        file.data[ktx2_level_entry(0, 0)] = static_cast<unsigned char>(offset);
+        file.data[ktx2_level_entry(0, 0) + 1] = static_cast<unsigned char>(offset >> 8);
+        file.data[ktx2_level_entry(0, 1)] = static_cast<unsigned char>(4 * block_size);
+        const auto path = write_file("ktx2-format.ktx2", file.data);
+        const KtxFile parsed(path);
+        KEX_CHECK(parsed.internal_format() == formats[i]);
+        KEX_CHECK(parsed.mip_levels().size() == 1 && parsed.mip_levels()[0].size == 4 * block_size);
+        std::filesystem::remove(path);
+    }
+}
+
+static void check_rejected(const std::vector<unsigned char> &bytes) {
+    const auto path = write_file("invalid.ktx", bytes);
+    KEX_CHECK_THROWS(KtxFile file(path), std::runtime_error);
+    std::filesystem::remove(path);
+}
+
+static std::vector<unsigned char> patched(Bytes file, std::size_t offset, std::uint32_t value) {
+    file.put_u32(offset, value);
+    return file.data;
+}
+
+static void test_ktx1_rejected(bool swap) {
+    const auto valid = make_ktx1({swap, "S=r,T=u"});
+    const auto &bytes = valid.data;
+
+    // Truncated within the identifier, the header, the key/value data and the levels
+    for (const std::size_t size: {std::size_t{0}, std::size_t{11}, std::size_t{KTX1_HEADER_SIZE - 1},
+                                  std::size_t{KTX1_HEADER_SIZE + 8}, bytes.size() - 12, bytes.size() - 1}) {
+        check_rejected({bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)});
+    }
+
+    check_rejected(patched(valid, 12, 0x01020305));                                // Endianness
+    check_rejected(patched(valid, KTX1_GL_TYPE, GL_UNSIGNED_BYTE));
+    check_rejected(patched(valid, KTX1_INTERNAL_FORMAT, GL_RGBA8));
+    check_rejected(patched(valid, KTX1_DEPTH, 2));
+    check_rejected(patched(valid, KTX1_ARRAY_ELEMENTS, 2));
+    check_rejected(patched(valid, KTX1_FACES, 6));
+    check_rejected(patched(valid, KTX1_WIDTH, 0));
+    check_rejected(patched(valid, KTX1_HEIGHT, 0));
+    check_rejected(patched(valid, KTX1_WIDTH, 20));                                // Levels too small
+    check_rejected(patched(valid, KTX1_LEVELS, 4));
+    check_rejected(patched(valid, KTX1_LEVELS, 33));
+    check_rejected(patched(valid, KTX1_KEY_VALUE_SIZE, 0xfffffff0));
+
+    // The size of the base level is wrong
+    const auto key_value_size = bytes.size() - KTX1_HEADER_SIZE - (4 + 48) - (4 + 16) - (4 + 8);
+    check_rejected(patched(valid, KTX1_HEADER_SIZE + key_value_size, 40));
+    check_rejected(patched(valid, KTX1_HEADER_SIZE + key_value_size, 0xfffffff8));
+}
+
+static void test_ktx2_rejected() {
+    const auto valid = make_ktx2("rd");
+    const auto &bytes = valid.data;
+
+    for (const std::size_t size: {std::size_t{0}, std::size_t{11}, std::size_t{KTX2_HEADER_SIZE - 1},
+                                  std::size_t{KTX2_HEADER_SIZE + 30}, bytes.size() - 17, bytes.size() - 1}) {
+        check_rejected({bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)});
+    }
+
+    check_rejected(patched(valid, KTX2_FORMAT, 37));                               // VK_FORMAT_R8G8B8A8_UNORM
+    check_rejected(patched(valid, KTX2_FORMAT, 146));
+    check_rejected(patched(valid, KTX2_FORMAT, 157));
+    check_rejected(patched(valid, KTX2_SUPERCOMPRESSION, 1));                      // BasisLZ
+    check_rejected(patched(valid, KTX2_SUPERCOMPRESSION, 2));                      // Zstandard
+    check_rejected(patched(valid, KTX2_DEPTH, 2));
+    check_rejected(patched(valid, KTX2_LAYERS, 2));
+    check_rejected(patched(valid, KTX2_FACES, 6));
+    check_rejected(patched(valid, KTX2_WIDTH, 0));
+    check_rejected(patched(valid, KTX2_HEIGHT, 0));
+    check_rejected(patched(valid, KTX2_WIDTH, 16));                                // Levels too small
+    check_rejected(patched(valid, KTX2_LEVELS, 5));
+    check_rejected(patched(valid, KTX2_LEVELS, 33));
+    check_rejected(patched(valid, KTX2_LEVELS, 0xffffffff));
+    check_rejected(patched(valid, KTX2_KEY_VALUE_OFFSET, 0xfffffff0));
+    check_rejected(patched(valid, KTX2_KEY_VALUE_SIZE, 0xfffffff0));
+
+    // Level sizes and offsets
+    check_rejected(patched(valid, ktx2_level_entry(0, 1), 48));
+    check_rejected(patched(valid, ktx2_level_entry(2, 1), 0));
+    check_rejected(patched(valid, ktx2_level_entry(0, 0), static_cast<std::uint32_t>(bytes.size() - 63)));
+    check_rejected(patched(valid, ktx2_level_entry(3, 0), 0xfffffff0));
+    auto far = valid;
+    far.put_u32(ktx2_level_entry(1, 0) + 4, 1);                                    // Offset beyond 4 GiB
+    check_rejected(far.data);
+}
+
+static void test_is_ktx_file() {
+    auto other = make_ktx2().data;
+    other[5] = '3';
+    const auto path = write_file("not-ktx.ktx2", other);
+    KEX_CHECK(!KtxFile::is_ktx_file(path));
+    KEX_CHECK_THROWS(KtxFile file(path), std::runtime_error);
+    std::filesystem::remove(path);
+
+    const auto short_path = write_file("short.ktx", {KTX1_IDENTIFIER.begin(), KTX1_IDENTIFIER.begin() + 11});
+    KEX_CHECK(!KtxFile::is_ktx_file(short_path));
+    std::filesystem::remove(short_path);
+    KEX_CHECK(!KtxFile::is_ktx_file(short_path));
+}
+
+int main() {
+    test_ktx1(false);
+    test_ktx1(true);
+    test_ktx1_orientation();
+    test_ktx2();
+    test_ktx2_formats();
+    test_ktx1_rejected(false);
+    test_ktx1_rejected(true);
+    test_ktx2_rejected();
+    test_is_ktx_file();
+    return kex::test::result();
+}
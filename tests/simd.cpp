@@ -0,0 +1,124 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "check.hpp"
+#include "kex/spriteinstance.hpp"
+#include "kex/spritesimd.hpp"
+
+using namespace kex;
+
+/** Largest absolute error of the sine and cosine, a few ULPs of values around one. */
+static constexpr double SINCOS_TOLERANCE = 2e-7;
+
+/** Decode a half-precision float, which pack_half must encode back into the same bits. */
+static float unpack_half(std::uint16_t half) {
+    const auto sign = half & 0x8000 ? -1.f : 1.f;
+    const auto exponent = (half >> 10) & 0x1F;
+    const auto mantissa = half & 0x3FF;
+    if (exponent == 0) return sign * std::ldexp(static_cast<float>(mantissa), -24);
+    if (exponent == 0x1F) return mantissa == 0 ? sign * std::numeric_limits<float>::infinity()
+                                               : std::numeric_limits<float>::quiet_NaN();
+    return sign * std::ldexp(static_cast<float>(mantissa | 0x400), exponent - 25);
+}
+
+/** Compute the sine and cosine of consecutive angles with the operations of one vector width. */
+template<typename Ops>
+static void test_sincos(float limit, int steps) {
+    float angles[Ops::width], sines[Ops::width], cosines[Ops::width];
+    double worst = 0;
+    for (int step = 0; step <= steps; step += Ops::width) {
+        for (int lane = 0; lane < Ops::width; ++lane) {
+            angles[lane] = -limit + 2 * limit * static_cast<float>(step + lane) / static_cast<float>(steps);
+        }
+        typename Ops::F sin, cos;
+        sincos<Ops>(Ops::load(angles), sin, cos);
+        Ops::store(sines, sin);
+        Ops::store(cosines, cos);
+        for (int lane = 0; lane < Ops::width; ++lane) {
+            const auto angle = static_cast<double>(angles[lane]);
+            worst = std::max(worst, std::fabs(sines[lane] - std::sin(angle)));
+            worst = std::max(worst, std::fabs(cosines[lane] - std::cos(angle)));
+        }
+    }
+    KEX_CHECK(worst <= SINCOS_TOLERANCE);
+}
+
+template<typename Ops>
+static void test_sincos_quadrants() {
+    // Multiples of pi/2 land exactly on the boundaries of the quadrants
+    for (int quadrant = -8; quadrant <= 8; ++quadrant) {
+        float angles[Ops::width], sines[Ops::width], cosines[Ops::width];
+        for (auto &angle: angles) angle = static_cast<float>(quadrant * 1.5707963267948966);
+        typename Ops::F sin, cos;
+        sincos<Ops>(Ops::load(angles), sin, cos);
+        Ops::store(sines, sin);
+        Ops::store(cosines, cos);
+        const auto angle = static_cast<double>(angles[0]);
+        KEX_CHECK(std::fabs(sines[0] - std::sin(angle)) <= SINCOS_TOLERANCE);
+        KEX_CHECK(std::fabs(cosines[0] - std::cos(angle)) <= SINCOS_TOLERANCE);
+    }
+}
+
+static void test_pack_half() {
+    KEX_CHECK(pack_half(0.f) == 0x0000);
+    KEX_CHECK(pack_half(-0.f) == 0x8000);
+    KEX_CHECK(pack_half(1.f) == 0x3C00);
+    KEX_CHECK(pack_half(-2.f) == 0xC000);
+    KEX_CHECK(pack_half(0.1f) == 0x2E66);
+    KEX_CHECK(pack_half(65504.f) == 0x7BFF);
+
+    // Round to nearest, ties to even
+    KEX_CHECK(pack_half(1.f + std::ldexp(1.f, -11)) == 0x3C00);
+    KEX_CHECK(pack_half(1.f + 3 * std::ldexp(1.f, -11)) == 0x3C02);
+    KEX_CHECK(pack_half(65520.f) == 0x7C00);
+
+    // Subnormal halves, and values too small for them
+    KEX_CHECK(pack_half(std::ldexp(1.f, -24)) == 0x0001);
+    KEX_CHECK(pack_half(std::ldexp(1.f, -25)) == 0x0000);
+    KEX_CHECK(pack_half(std::ldexp(3.f, -26)) == 0x0001);
+    KEX_CHECK(pack_half(-std::ldexp(1.f, -30)) == 0x8000);
+
+    // Infinity and NaN
+    KEX_CHECK(pack_half(std::numeric_limits<float>::infinity()) == 0x7C00);
+    KEX_CHECK(pack_half(-1e30f) == 0xFC00);
+    KEX_CHECK((pack_half(std::numeric_limits<float>::quiet_NaN()) & 0x7E00) == 0x7E00);
+
+    // Every finite half survives the round trip
+    for (std::uint32_t bits = 0; bits <= 0xFFFF; ++bits) {
+        const auto half = static_cast<std::uint16_t>(bits);
+        if ((half & 0x7C00) == 0x7C00) continue;
+        KEX_CHECK(pack_half(unpack_half(half)) == half);
+    }
+}
+
+int main() {
+    test_sincos<ScalarOps>(4, 100000);
+    test_sincos<ScalarOps>(4000, 100000);
+    test_sincos<SimdOps>(4, 100000);
+    test_sincos<SimdOps>(4000, 100000);
+    test_sincos_quadrants<ScalarOps>();
+    test_sincos_quadrants<SimdOps>();
+    test_pack_half();
+    return kex::test::result();
+}
@@ -0,0 +1,119 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "check.hpp"
+#include "kex/spritesort.hpp"
+
+using namespace kex;
+
+/** Sort entries with std::stable_sort, which the radix sort must agree with. */
+static std::vector<SpriteSortEntry> reference_sort(std::vector<SpriteSortEntry> entries) {
+    std::stable_sort(entries.begin(), entries.end(), [](const SpriteSortEntry &a, const SpriteSortEntry &b) {
+        return a.key < b.key;
+    });
+    return entries;
+}
+
+static bool same_order(const std::vector<SpriteSortEntry> &a, const std::vector<SpriteSortEntry> &b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const SpriteSortEntry &x, const SpriteSortEntry &y) {
+        return x.key == y.key && x.index == y.index;
+    });
+}
+
+static void test_sort_key_layout() {
+    const auto key = make_sort_key(3, SpriteProgram::TEXTURE_ARRAY, 0x1234);
+    KEX_CHECK(key >> SORT_KEY_LAYER_SHIFT == 3 + 32768);
+    KEX_CHECK(sort_key_program(key) == SpriteProgram::TEXTURE_ARRAY);
+    KEX_CHECK(sort_key_texture(key) == 0x1234);
+    const auto other_layer = make_sort_key(-7, SpriteProgram::TEXTURE_ARRAY, 0x1234);
+    KEX_CHECK((key & SORT_KEY_STATE_MASK) == (other_layer & SORT_KEY_STATE_MASK));
+
+    // Layers sort first, negative ones before positive ones, then programs and textures
+    KEX_CHECK(make_sort_key(-32768, SpriteProgram::TEXTURE_ARRAY, 0xFFFF) <
+              make_sort_key(-1, SpriteProgram::TEXTURE, 0));
+    KEX_CHECK(make_sort_key(-1, SpriteProgram::TEXTURE_ARRAY, 0xFFFF) < make_sort_key(0, SpriteProgram::TEXTURE, 0));
+    KEX_CHECK(make_sort_key(0, SpriteProgram::TEXTURE_ARRAY, 0xFFFF) < make_sort_key(32767, SpriteProgram::TEXTURE, 0));
+    KEX_CHECK(make_sort_key(0, SpriteProgram::TEXTURE, 0xFFFF) < make_sort_key(0, SpriteProgram::TEXTURE_ARRAY, 0));
+    KEX_CHECK(make_sort_key(0, SpriteProgram::TEXTURE, 1) < make_sort_key(0, SpriteProgram::TEXTURE, 2));
+}
+
+static void test_check_layer() {
+    check_layer(-32768);
+    check_layer(32767);
+    KEX_CHECK_THROWS(check_layer(-32769), std::out_of_range);
+    KEX_CHECK_THROWS(check_layer(32768), std::out_of_range);
+}
+
+static void test_radix_sort() {
+    std::vector<SpriteSortEntry> scratch;
+
+    // Empty and single entries are left alone
+    std::vector<SpriteSortEntry> entries;
+    radix_sort(entries, scratch);
+    KEX_CHECK(entries.empty());
+    entries = {{42, 0}};
+    radix_sort(entries, scratch);
+    KEX_CHECK(entries.size() == 1 && entries[0].key == 42);
+
+    // Equal keys skip every pass and keep their order
+    entries.assign(100, {make_sort_key(1, SpriteProgram::TEXTURE, 5), 0});
+    for (std::uint32_t i = 0; i < entries.size(); ++i) entries[i].index = i;
+    auto expected = entries;
+    radix_sort(entries, scratch);
+    KEX_CHECK(same_order(entries, expected));
+
+    // Few layers and textures, the usual case, with many equal keys whose order must be stable
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int> layer(-3, 3);
+    std::uniform_int_distribution<int> texture(0, 9);
+    std::uniform_int_distribution<int> program(0, 1);
+    entries.clear();
+    for (std::uint32_t i = 0; i < 5000; ++i) {
+        const auto key = make_sort_key(layer(random), static_cast<SpriteProgram>(program(random)),
+                                       static_cast<TextureHandle>(texture(random)));
+        entries.push_back({key, i});
+    }
+    expected = reference_sort(entries);
+    radix_sort(entries, scratch);
+    KEX_CHECK(same_order(entries, expected));
+
+    // Keys differing in every byte
+    std::uniform_int_distribution<std::uint64_t> any;
+    entries.clear();
+    for (std::uint32_t i = 0; i < 5000; ++i) {
+        entries.push_back({any(random), i});
+    }
+    entries.push_back(entries[10]);
+    entries.back().index = 5000;
+    expected = reference_sort(entries);
+    radix_sort(entries, scratch);
+    KEX_CHECK(same_order(entries, expected));
+}
+
+int main() {
+    test_sort_key_layout();
+    test_check_layer();
+    test_radix_sort();
+    return kex::test::result();
+}
@@ -0,0 +1,119 @@
+/*
+Kex: Plug-and-play 2D graphics C++ library built on top of OpenGL ES 3.0 API
+Copyright (C) 2023  Borna Bešić
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <kex/atlas.hpp>
+
+namespace fs = std::filesystem;
+
+static const char *const USAGE =
+        "Usage: kex-atlas [options] <asset-directory> <output-file>\n"
+        "\n"
+        "Pack all images of a directory into a binary atlas file.\n"
+        "Regions are named by the paths of the images relative to the directory, without extensions.\n"
+        "\n"
+        "Options:\n"
+        "  --max-size <px>  Maximum width and height of the atlas (default: 2048)\n"
+        "  --padding <px>   Padding around each image (default: 1)\n"
+        "  --mipmap         Store a precomputed mipmap\n"
+        "  --help           Show this message\n";
+
+static bool is_image(const fs::path &path) {
+    static const std::vector<std::string> extensions = {".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd"};
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+}
+
+static int parse_size(const std::string &option, const std::string &value) {
+    try {
+        return std::stoi(value);
+    } catch (const std::exception &) {
+        throw std::invalid_argument(option + " expects a number of pixels");
+    }
+}
+
+int main(int argc, char **argv) {
+    int max_size = 2048;
+    int padding = 1;
+    bool mipmap = false;
+    std::vector<std::string> positional;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument = argv[i];
+            if (argument == "--help") {
+                std::cout << USAGE;
+                return EXIT_SUCCESS;
+            } else if (argument == "--mipmap") {
+                mipmap = true;
+            } else if ((argument == "--max-size" || argument == "--padding") && i + 1 < argc) {
+                (argument == "--max-size" ? max_size : padding) = parse_size(argument, argv[++i]);
+            } else if (argument.rfind("--", 0) == 0) {
+                throw std::invalid_argument("Unknown option " + argument);
+            } else {
+                positional.push_back(argument);
+            }
+        }
+        if (positional.size() != 2) {
+            std::cerr << USAGE;
+            return EXIT_FAILURE;
+        }
+
+        const fs::path directory = positional[0];
+        const fs::path output = positional[1];
+        if (!fs::is_directory(directory)) {
+            throw std::invalid_argument(directory.string() + " is not a directory");
+        }
+
+        // Sort the paths so that the same directory always produces the same atlas
+        std::vector<fs::path> paths;
+        for (const auto &entry: fs::recursive_directory_iterator(directory)) {
+            if (entry.is_regular_file() && is_image(entry.path())) {
+                paths.push_back(entry.path());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+
+        kex::AtlasBuilder builder(max_size, padding);
+        for (const auto &path: paths) {
+            auto name = fs::relative(path, directory);
+            name.replace_extension();
+            builder.add(name.generic_string(), path.string());
+        }
+
+        const auto atlas = builder.compose();
+        atlas.save(output.string(), mipmap);
+        std::cout << "Packed " << atlas.regions.size() << " images into a " << atlas.width << "x" << atlas.height
+                  << " atlas " << output.string() << '\n';
+    } catch (const std::exception &error) {
+        std::cerr << "kex-atlas: " << error.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}